@@ -26,6 +26,10 @@
 
 #include "vbase.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /* Handle to lock free pool. */
 typedef void* vintpool_t;
 
@@ -67,3 +71,7 @@ void vintpool_free(vintpool_t pool, int index);
 ** @see vintpool_create
 */
 int vintpool_get_index_count(vintpool_t p);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,186 @@
+#pragma once
+
+/*
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to
+** deal in the Software without restriction, including without limitation the
+** rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+** sell copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+** IN THE SOFTWARE.
+**
+** Lock free pool, C++ front-end with compile-time capacity.
+** Same algorithm and trace hooks as vintpool, but storage is embedded in the
+** object and every operation is inlined into the caller.
+** The algorithm is duplicated in containers/vintpool.impl.c; change both
+** together.
+*/
+
+#include "vbase.h"
+#include "thread/vtrace.h"
+
+#include <atomic>
+#include <optional>
+
+namespace viper
+{
+	namespace detail
+	{
+		/* Index/ABA-count pair packed in 64 bits, same layout as vintpool_pointer_t. */
+		static constexpr uint32_t k_invalid_index = 0xffffffff;
+
+		force_inline uint64_t make_link(uint32_t index, uint32_t count)
+		{
+			return (uint64_t)index | ((uint64_t)count << 32);
+		}
+
+		force_inline uint32_t link_index(uint64_t link)
+		{
+			return (uint32_t)link;
+		}
+
+		force_inline uint32_t link_count(uint64_t link)
+		{
+			return (uint32_t)(link >> 32);
+		}
+	}
+
+	/*
+	** Lock free integer pool handing out indices in [0, N).
+	** Thread-safe. Not copyable or movable, since other threads may hold indices into it.
+	*/
+	template <uint32_t N>
+	class intpool
+	{
+		static_assert(N > 0, "intpool must hold at least one index");
+		static_assert(N < detail::k_invalid_index, "intpool index count out of range");
+
+	public:
+		/* Number of indices in the pool. */
+		static constexpr uint32_t index_count = N;
+
+		intpool()
+		{
+			for (uint32_t i = 0; i < N - 1; ++i)
+			{
+				_next[i].store(detail::make_link(i + 1, 0), std::memory_order_relaxed);
+			}
+			_next[N - 1].store(detail::make_link(detail::k_invalid_index, 0), std::memory_order_relaxed);
+			_free_list.store(detail::make_link(0, 0), std::memory_order_release);
+		}
+
+		intpool(const intpool&) = delete;
+		intpool& operator=(const intpool&) = delete;
+
+		/*
+		** Allocate an index from the pool. Spins until an index is free.
+		** @return A new index.
+		** @see free
+		*/
+		force_inline uint32_t alloc()
+		{
+			bool is_empty = false;
+			int retry_count = 0;
+
+			std::optional<uint32_t> index;
+			while (!(index = _try_alloc(retry_count)))
+			{
+				if (!is_empty)
+				{
+					is_empty = true;
+					VTRACE_HOOK_BEGIN("vintpool empty");
+				}
+			}
+
+			if (is_empty)
+			{
+				VTRACE_HOOK_END("vintpool empty");
+			}
+			if (retry_count)
+			{
+				VTRACE_HOOK_COUNTER("vintpool_alloc retries", retry_count);
+			}
+			return *index;
+		}
+
+		/*
+		** Allocate an index from the pool without spinning.
+		** @return A new index, or nothing if the pool is exhausted.
+		** @see free
+		*/
+		force_inline std::optional<uint32_t> try_alloc()
+		{
+			int retry_count = 0;
+			std::optional<uint32_t> index = _try_alloc(retry_count);
+			if (retry_count)
+			{
+				VTRACE_HOOK_COUNTER("vintpool_alloc retries", retry_count);
+			}
+			return index;
+		}
+
+		/*
+		** Free previously allocated pool index.
+		** @param index The index to free.
+		** @see alloc
+		*/
+		force_inline void free(uint32_t index)
+		{
+			int retry_count = 0;
+			uint64_t free_list = _free_list.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				_next[index].store(detail::make_link(detail::link_index(free_list), 0), std::memory_order_relaxed);
+
+				uint64_t link = detail::make_link(index, detail::link_count(free_list) + 1);
+				if (_free_list.compare_exchange_weak(free_list, link, std::memory_order_release, std::memory_order_relaxed))
+				{
+					break;
+				}
+				++retry_count;
+			}
+
+			if (retry_count)
+			{
+				VTRACE_HOOK_COUNTER("vintpool_free retries", retry_count);
+			}
+		}
+
+	private:
+		force_inline std::optional<uint32_t> _try_alloc(int& retry_count)
+		{
+			uint64_t free_list = _free_list.load(std::memory_order_acquire);
+			for (;;)
+			{
+				uint32_t index = detail::link_index(free_list);
+				if (index == detail::k_invalid_index)
+				{
+					return std::nullopt;
+				}
+
+				uint64_t next = _next[index].load(std::memory_order_relaxed);
+				uint64_t link = detail::make_link(detail::link_index(next), detail::link_count(free_list) + 1);
+				if (_free_list.compare_exchange_weak(free_list, link, std::memory_order_acquire, std::memory_order_acquire))
+				{
+					return index;
+				}
+				++retry_count;
+			}
+		}
+
+		alignas(VCACHE_LINE_SIZE) std::atomic<uint64_t> _free_list;
+		alignas(VCACHE_LINE_SIZE) std::atomic<uint64_t> _next[N];
+	};
+}
@@ -23,6 +23,9 @@
 #include "containers/vintpool.h"
 
 #include "thread/vatomic.h"
+#include "thread/vtrace.h"
+
+/* The algorithm is duplicated in viper::intpool (containers/vintpool.hpp); change both together. */
 
 typedef struct _vintpool_nodecount_t
 {
@@ -52,6 +55,8 @@ typedef struct _vintpool_impl_t
 
 static const uint32_t k_vintpool_invalid_index = 0xffffffff;
 
+static force_inline vintpool_pointer_t _load_pointer(const vintpool_pointer_t* pointer);
+
 size_t vintpool_get_bytes_required(int index_count)
 {
 	return sizeof(vintpool_impl_t) + (sizeof(vintpool_node_t) * index_count);
@@ -80,15 +85,18 @@ int vintpool_alloc(vintpool_t p)
 {
 	int index;
 	vintpool_impl_t* pool = (vintpool_impl_t*)(p);
+	bool is_empty = false;
+	int retry_count = -1;
 
 	for (;;)
 	{
-		vintpool_pointer_t free_list = pool->free_list;
+		vintpool_pointer_t free_list = _load_pointer(&pool->free_list);
 
 		if (free_list.part.index != k_vintpool_invalid_index)
 		{
+			++retry_count;
 			index = free_list.part.index;
-			vintpool_pointer_t next = pool->nodes[index].next;
+			vintpool_pointer_t next = _load_pointer(&pool->nodes[index].next);
 
 			vintpool_pointer_t link = { .part.index = next.part.index, .part.count = free_list.part.count + 1 };
 			if (vatomic64_compare_exchange(&pool->free_list.entire, free_list.entire, link.entire) == free_list.entire)
@@ -96,8 +104,21 @@ int vintpool_alloc(vintpool_t p)
 				break;
 			}
 		}
+		else if (!is_empty)
+		{
+			is_empty = true;
+			VTRACE_HOOK_BEGIN("vintpool empty");
+		}
 	}
 
+	if (is_empty)
+	{
+		VTRACE_HOOK_END("vintpool empty");
+	}
+	if (retry_count)
+	{
+		VTRACE_HOOK_COUNTER("vintpool_alloc retries", retry_count);
+	}
 	return index;
 }
 
@@ -106,9 +127,12 @@ void vintpool_free(vintpool_t p, int index)
 	vintpool_impl_t* pool = (vintpool_impl_t*)(p);
 
 	vintpool_node_t* node = pool->nodes + index;
+	int retry_count = -1;
+
 	for (;;)
 	{
-		vintpool_pointer_t free_list = pool->free_list;
+		++retry_count;
+		vintpool_pointer_t free_list = _load_pointer(&pool->free_list);
 		node->next.part.index = free_list.part.index;
 
 		vintpool_pointer_t link = { .part.index = index, .part.count = free_list.part.count + 1 };
@@ -117,6 +141,11 @@ void vintpool_free(vintpool_t p, int index)
 			break;
 		}
 	}
+
+	if (retry_count)
+	{
+		VTRACE_HOOK_COUNTER("vintpool_free retries", retry_count);
+	}
 }
 
 int vintpool_get_index_count(vintpool_t p)
@@ -124,3 +153,11 @@ int vintpool_get_index_count(vintpool_t p)
 	vintpool_impl_t* pool = (vintpool_impl_t*)(p);
 	return pool->index_count;
 }
+
+static force_inline vintpool_pointer_t _load_pointer(const vintpool_pointer_t* pointer)
+{
+	/* Shared pointers must be reloaded on every pass, or the compiler may hoist the load out of a spin loop. */
+	vintpool_pointer_t result;
+	result.entire = (uint64_t)vatomic64_load((const int64_t*)&pointer->entire);
+	return result;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+/*
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to
+** deal in the Software without restriction, including without limitation the
+** rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+** sell copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+** IN THE SOFTWARE.
+**
+** Lock free multi-level priority queue. Each priority level is a vqueue lane,
+** and a bitmap of non-empty levels lets pop find the most urgent lane with a
+** single load and a bit scan.
+*/
+
+#include "vbase.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Handle to lock free priority queue. */
+typedef void* vprioqueue_t;
+
+/* Maximum number of priority levels. */
+#define VPRIOQUEUE_MAX_LEVELS 32
+
+/*
+** Gets the amount of memory required by a priority queue.
+** @param level_count Number of priority levels, at most VPRIOQUEUE_MAX_LEVELS.
+** @param level_capacity Maximum number of items at each level.
+** @return The amount of memory required.
+** @see vprioqueue_create
+*/
+size_t vprioqueue_get_bytes_required(int level_count, int level_capacity);
+
+/*
+** Create a lock free priority queue.
+** @param buffer A buffer of size vprioqueue_get_bytes_required().
+** @param level_count Number of priority levels, at most VPRIOQUEUE_MAX_LEVELS.
+** @param level_capacity Maximum number of items at each level.
+** @param aging_interval If positive, one in every aging_interval pops that
+**        bypass lower non-empty levels serves one of them instead, rotating
+**        through them, so they are not starved. Bypasses are counted per
+**        popping thread. If zero, priority is strict.
+** @return A new priority queue.
+** @see vprioqueue_get_bytes_required
+*/
+vprioqueue_t vprioqueue_create(void* buffer, int level_count, int level_capacity, int aging_interval);
+
+/*
+** Push data onto a priority level. Spins until the level has space.
+** @param queue The queue on which to push the data.
+** @param level Priority level, where 0 is the most urgent.
+** @param data The data to push on the queue.
+** @see vprioqueue_pop
+*/
+void vprioqueue_push(vprioqueue_t queue, int level, void* data);
+
+/*
+** Pop data from the most urgent non-empty level. Items within a level are FIFO.
+** @param queue The queue to pop data off.
+** @param data On successful return, pointer to data popped.
+** @return If the queue was not empty, true is returned.
+** @see vprioqueue_push
+*/
+bool vprioqueue_pop(vprioqueue_t queue, void** data);
+
+/*
+** Gets the number of priority levels in the queue.
+** @see vprioqueue_create
+*/
+int vprioqueue_get_level_count(vprioqueue_t queue);
+
+#ifdef __cplusplus
+}
+#endif
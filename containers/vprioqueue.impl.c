@@ -0,0 +1,187 @@
+/*
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to
+** deal in the Software without restriction, including without limitation the
+** rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+** sell copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+** IN THE SOFTWARE.
+*/
+
+#include "containers/vprioqueue.h"
+
+#include "containers/vqueue.h"
+#include "thread/vatomic.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+typedef struct _vprioqueue_impl_t
+{
+	/* Bit N is set while level N may be non-empty. Read by every pop. */
+	int32_t level_bits;
+	char level_bits_padding[VCACHE_LINE_SIZE - sizeof(int32_t)];
+
+	int level_count;
+	int aging_interval;
+
+	vqueue_t levels[VPRIOQUEUE_MAX_LEVELS];
+} vprioqueue_impl_t;
+
+/* Pops by this thread that bypassed lower non-empty levels, across all queues. Only touched when aging is enabled. */
+static __thread uint32_t t_vprioqueue_bypass_count = 0;
+
+static int _bit_scan_forward(uint32_t bits);
+static int _select_aged_level(uint32_t bits, uint32_t rotation);
+static void _set_level_bit(vprioqueue_impl_t* queue, int level);
+static void _clear_level_bit(vprioqueue_impl_t* queue, int level);
+
+size_t vprioqueue_get_bytes_required(int level_count, int level_capacity)
+{
+	/* Each vqueue spends a node on its dummy. */
+	return sizeof(vprioqueue_impl_t) + (vqueue_get_bytes_required_ex(level_capacity + 1, k_vqueue_flag_no_count) * level_count);
+}
+
+vprioqueue_t vprioqueue_create(void* buffer, int level_count, int level_capacity, int aging_interval)
+{
+	vprioqueue_impl_t* queue = (vprioqueue_impl_t*)buffer;
+
+	queue->level_bits = 0;
+	queue->level_count = level_count;
+	queue->aging_interval = aging_interval;
+
+	char* level_buffer = (char*)(queue + 1);
+	for (int i = 0; i < level_count; ++i)
+	{
+		queue->levels[i] = vqueue_create_ex(level_buffer, level_capacity + 1, k_vqueue_flag_no_count);
+		level_buffer += vqueue_get_bytes_required_ex(level_capacity + 1, k_vqueue_flag_no_count);
+	}
+
+	vatomic_barrier();
+
+	return queue;
+}
+
+void vprioqueue_push(vprioqueue_t q, int level, void* data)
+{
+	vprioqueue_impl_t* queue = (vprioqueue_impl_t*)(q);
+
+	/* Push before setting the bit, so a pop that sees the bit finds the data. */
+	vqueue_push(queue->levels[level], data);
+	_set_level_bit(queue, level);
+}
+
+bool vprioqueue_pop(vprioqueue_t q, void** data)
+{
+	vprioqueue_impl_t* queue = (vprioqueue_impl_t*)(q);
+
+	for (;;)
+	{
+		uint32_t level_bits = (uint32_t)vatomic32_load(&queue->level_bits);
+		if (!level_bits)
+		{
+			return false;
+		}
+
+		int level = _bit_scan_forward(level_bits);
+
+		/* Every so often, serve a lower level that this pop would otherwise bypass. */
+		uint32_t lower_bits = level_bits & (level_bits - 1);
+		if (queue->aging_interval > 0 && lower_bits)
+		{
+			uint32_t bypass_count = t_vprioqueue_bypass_count++;
+			if (bypass_count % queue->aging_interval == (uint32_t)queue->aging_interval - 1)
+			{
+				level = _select_aged_level(lower_bits, bypass_count / queue->aging_interval);
+			}
+		}
+
+		if (vqueue_pop(queue->levels[level], data))
+		{
+			return true;
+		}
+
+		/*
+		** The level looks empty, so clear its bit. A push may have landed after
+		** our pop but seen the bit still set, so check again once it is clear.
+		*/
+		_clear_level_bit(queue, level);
+		if (vqueue_pop(queue->levels[level], data))
+		{
+			_set_level_bit(queue, level);
+			return true;
+		}
+	}
+}
+
+int vprioqueue_get_level_count(vprioqueue_t q)
+{
+	vprioqueue_impl_t* queue = (vprioqueue_impl_t*)(q);
+	return queue->level_count;
+}
+
+static int _bit_scan_forward(uint32_t bits)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, bits);
+	return (int)index;
+#else
+	return __builtin_ctz(bits);
+#endif
+}
+
+static int _select_aged_level(uint32_t bits, uint32_t rotation)
+{
+	int bit_count = 0;
+	for (uint32_t remaining = bits; remaining; remaining &= remaining - 1)
+	{
+		++bit_count;
+	}
+
+	/* Drop the lowest set bits to rotate through the candidate levels. */
+	for (uint32_t skip = rotation % bit_count; skip; --skip)
+	{
+		bits &= bits - 1;
+	}
+	return _bit_scan_forward(bits);
+}
+
+static void _set_level_bit(vprioqueue_impl_t* queue, int level)
+{
+	int32_t bit = (int32_t)(1u << level);
+	for (;;)
+	{
+		int32_t level_bits = vatomic32_load(&queue->level_bits);
+		if ((level_bits & bit) || vatomic32_compare_exchange(&queue->level_bits, level_bits, level_bits | bit) == level_bits)
+		{
+			break;
+		}
+	}
+}
+
+static void _clear_level_bit(vprioqueue_impl_t* queue, int level)
+{
+	int32_t bit = (int32_t)(1u << level);
+	for (;;)
+	{
+		int32_t level_bits = vatomic32_load(&queue->level_bits);
+		if (!(level_bits & bit) || vatomic32_compare_exchange(&queue->level_bits, level_bits, level_bits & ~bit) == level_bits)
+		{
+			break;
+		}
+	}
+}
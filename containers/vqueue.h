@@ -27,9 +27,20 @@
 
 #include "vbase.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /* Handle to lock free queue. */
 typedef void* vqueue_t;
 
+/* Options for vqueue_create_ex. */
+enum
+{
+	/* Don't track the number of items. Push and pop skip the counter update, and vqueue_get_count returns -1. */
+	k_vqueue_flag_no_count = 1 << 0,
+};
+
 /*
 ** Gets the amount of memory required by queue of the specified size.
 ** @param node_count Maximum of nodes in the queue.
@@ -47,6 +58,25 @@ size_t vqueue_get_bytes_required(int node_count);
 */
 vqueue_t vqueue_create(void* buffer, int node_count);
 
+/*
+** Gets the amount of memory required by queue of the specified size and options.
+** @param node_count Maximum of nodes in the queue.
+** @param flags Combination of k_vqueue_flag_* values.
+** @return The amount of memory required.
+** @see vqueue_create_ex
+*/
+size_t vqueue_get_bytes_required_ex(int node_count, uint32_t flags);
+
+/*
+** Create a lock free queue with options.
+** @param buffer A buffer of size vqueue_get_bytes_required_ex().
+** @param node_count Maximum of nodes in the queue.
+** @param flags Combination of k_vqueue_flag_* values, the same as passed to vqueue_get_bytes_required_ex.
+** @return A new lock free queue.
+** @see vqueue_get_bytes_required_ex
+*/
+vqueue_t vqueue_create_ex(void* buffer, int node_count, uint32_t flags);
+
 /*
 ** Push data onto a queue.
 ** @param queue The queue on which to push the data.
@@ -65,6 +95,12 @@ void vqueue_push(vqueue_t queue, void* data);
 bool vqueue_pop(vqueue_t queue, void** data);
 
 /*
-** Get the number of items in the queue.
+** Get the number of items in the queue. Intended for telemetry; the count is
+** kept in a sharded counter and is only exact when the queue is quiescent.
+** @return The number of items, or -1 if created with k_vqueue_flag_no_count or built with VQUEUE_NO_COUNT.
 */
 int vqueue_get_count(vqueue_t q);
+
+#ifdef __cplusplus
+}
+#endif
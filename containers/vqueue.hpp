@@ -0,0 +1,383 @@
+#pragma once
+
+/*
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to
+** deal in the Software without restriction, including without limitation the
+** rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+** sell copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+** IN THE SOFTWARE.
+**
+** Lock free queue, C++ front-end with compile-time capacity.
+** Same algorithm, optional counting and trace hooks as vqueue, but storage is
+** embedded in the object and every operation is inlined into the caller.
+** vqueue stays in C rather than wrapping this template, so C users don't need
+** a C++ compiler. The algorithm is duplicated in containers/vqueue.impl.c;
+** change both together.
+** https://www.research.ibm.com/people/m/michael/podc-1996.pdf
+*/
+
+#include "containers/vintpool.hpp"
+#include "thread/vcounter.hpp"
+#include "thread/vtrace.h"
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace viper
+{
+	namespace detail
+	{
+		/* Out-of-line element storage, used when T cannot be copied speculatively. */
+		template <typename T, uint32_t N, bool k_inline>
+		struct queue_slots
+		{
+		};
+
+		template <typename T, uint32_t N>
+		struct queue_slots<T, N, false>
+		{
+			intpool<N> pool;
+			alignas(T) unsigned char data[N][sizeof(T)];
+
+			force_inline T* get(uint32_t index)
+			{
+				return std::launder(reinterpret_cast<T*>(data[index]));
+			}
+		};
+
+		/* Stands in for the element counter in uncounted queues. */
+		struct queue_no_count
+		{
+			force_inline void add(int64_t)
+			{
+			}
+
+			force_inline int64_t get() const
+			{
+				return -1;
+			}
+		};
+	}
+
+	/*
+	** Lock free queue holding up to N elements of type T.
+	** Trivially copyable types are stored directly in the queue nodes. Other
+	** types are moved into a slot allocated from an internal intpool, and the
+	** node carries the slot index.
+	** If k_counted is true, the queue tracks its number of items for get_count.
+	** Thread-safe. Not copyable or movable.
+	*/
+	template <typename T, uint32_t N, bool k_counted = false>
+	class queue
+	{
+		static_assert(N > 0, "queue must hold at least one element");
+		static_assert(N < detail::k_invalid_index - 1, "queue capacity out of range");
+
+		static constexpr bool k_inline_data = std::is_trivially_copyable<T>::value;
+		typedef typename std::conditional<k_inline_data, T, uint32_t>::type payload_t;
+
+		/* One extra node for the dummy at the head of the queue. */
+		static constexpr uint32_t k_node_count = N + 1;
+
+#if !defined(VQUEUE_NO_COUNT)
+		/* Shards used by the element counter, matching vqueue. */
+		typedef typename std::conditional<k_counted, counter<16>, detail::queue_no_count>::type count_t;
+#else
+		typedef detail::queue_no_count count_t;
+#endif
+
+		struct node_t
+		{
+			std::atomic<uint64_t> next;
+			alignas(payload_t) unsigned char data[sizeof(payload_t)];
+		};
+
+	public:
+		/* Maximum number of elements in the queue. */
+		static constexpr uint32_t capacity = N;
+
+		queue()
+		{
+			for (uint32_t i = 0; i < k_node_count - 1; ++i)
+			{
+				_nodes[i].next.store(detail::make_link(i + 1, 0), std::memory_order_relaxed);
+			}
+			_nodes[k_node_count - 1].next.store(detail::make_link(detail::k_invalid_index, 0), std::memory_order_relaxed);
+			_free_list.store(detail::make_link(0, 0), std::memory_order_relaxed);
+
+			/* Populate the queue with a dummy node. */
+			uint32_t dummy_index = _alloc_node_index();
+			_nodes[dummy_index].next.store(detail::make_link(detail::k_invalid_index, 0), std::memory_order_relaxed);
+
+			_head.store(detail::make_link(dummy_index, 0), std::memory_order_relaxed);
+			_tail.store(detail::make_link(dummy_index, 0), std::memory_order_release);
+		}
+
+		~queue()
+		{
+			if constexpr (!k_inline_data)
+			{
+				while (pop())
+				{
+				}
+			}
+		}
+
+		queue(const queue&) = delete;
+		queue& operator=(const queue&) = delete;
+
+		/*
+		** Push a copy of value onto the queue. Spins until the queue has space.
+		** @see pop
+		*/
+		force_inline void push(const T& value)
+		{
+			if constexpr (k_inline_data)
+			{
+				_push_payload(value);
+			}
+			else
+			{
+				uint32_t slot = _slots.pool.alloc();
+				new (_slots.data[slot]) T(value);
+				_push_payload(slot);
+			}
+		}
+
+		/*
+		** Move value onto the queue. Spins until the queue has space.
+		** @see pop
+		*/
+		force_inline void push(T&& value)
+		{
+			if constexpr (k_inline_data)
+			{
+				_push_payload(value);
+			}
+			else
+			{
+				uint32_t slot = _slots.pool.alloc();
+				new (_slots.data[slot]) T(std::move(value));
+				_push_payload(slot);
+			}
+		}
+
+		/*
+		** Pop the oldest element off the queue.
+		** @return The element, or nothing if the queue was empty.
+		** @see push
+		*/
+		force_inline std::optional<T> pop()
+		{
+			std::optional<payload_t> payload = _pop_payload();
+			if constexpr (k_inline_data)
+			{
+				return payload;
+			}
+			else
+			{
+				if (!payload)
+				{
+					return std::nullopt;
+				}
+
+				T* element = _slots.get(*payload);
+				std::optional<T> result(std::move(*element));
+				element->~T();
+				_slots.pool.free(*payload);
+				return result;
+			}
+		}
+
+		/*
+		** Get the number of items in the queue. Intended for telemetry; only exact
+		** when the queue is quiescent.
+		** @return The number of items, or -1 if the queue is not counted or built with VQUEUE_NO_COUNT.
+		*/
+		force_inline int get_count() const
+		{
+			return (int)_count.get();
+		}
+
+	private:
+		force_inline void _push_payload(const payload_t& payload)
+		{
+			/* Allocate a new node for this data. Keep the ABA count of the link. */
+			uint32_t node_index = _alloc_node_index();
+			node_t* node = _nodes + node_index;
+			new (node->data) payload_t(payload);
+			uint64_t unlinked = node->next.load(std::memory_order_relaxed);
+			node->next.store(detail::make_link(detail::k_invalid_index, detail::link_count(unlinked)), std::memory_order_relaxed);
+
+			uint64_t tail;
+			int retry_count = -1;
+
+			/* Try until the push succeeds. */
+			for (;;)
+			{
+				++retry_count;
+				tail = _tail.load(std::memory_order_acquire);
+				std::atomic<uint64_t>& tail_next = _nodes[detail::link_index(tail)].next;
+				uint64_t next = tail_next.load(std::memory_order_acquire);
+
+				/* Is our view of the queue still consistent? If not, try again. */
+				if (tail == _tail.load(std::memory_order_acquire))
+				{
+					/* Is tail pointing to last node? */
+					if (detail::link_index(next) == detail::k_invalid_index)
+					{
+						/* Attempt to push new node onto tail. Leave the loop on success. */
+						uint64_t link = detail::make_link(node_index, detail::link_count(next) + 1);
+						if (tail_next.compare_exchange_strong(next, link, std::memory_order_acq_rel))
+						{
+							break;
+						}
+					}
+
+					/* Tail has fallen behind the actual end of the queue. Fix that. */
+					else
+					{
+						uint64_t expected = tail;
+						uint64_t link = detail::make_link(detail::link_index(next), detail::link_count(tail) + 1);
+						_tail.compare_exchange_strong(expected, link, std::memory_order_acq_rel);
+					}
+				}
+			}
+
+			/* Try to advance the tail pointer. We'll handle the fail case on future calls. */
+			uint64_t link = detail::make_link(node_index, detail::link_count(tail) + 1);
+			_tail.compare_exchange_strong(tail, link, std::memory_order_acq_rel);
+
+			_count.add(1);
+
+			if (retry_count)
+			{
+				VTRACE_HOOK_COUNTER("vqueue_push retries", retry_count);
+			}
+		}
+
+		force_inline std::optional<payload_t> _pop_payload()
+		{
+			int retry_count = -1;
+
+			for (;;)
+			{
+				++retry_count;
+				uint64_t head = _head.load(std::memory_order_acquire);
+				uint64_t tail = _tail.load(std::memory_order_acquire);
+				uint64_t next = _nodes[detail::link_index(head)].next.load(std::memory_order_acquire);
+
+				/* Is our view of the queue still consistent? If not, try again. */
+				if (head != _head.load(std::memory_order_acquire))
+				{
+					continue;
+				}
+
+				if (detail::link_index(head) == detail::link_index(tail))
+				{
+					/* If queue is empty, fail the pop. */
+					if (detail::link_index(next) == detail::k_invalid_index)
+					{
+						return std::nullopt;
+					}
+
+					/* Tail has fallen behind the actual end of the queue. Fix that. */
+					uint64_t link = detail::make_link(detail::link_index(next), detail::link_count(tail) + 1);
+					_tail.compare_exchange_strong(tail, link, std::memory_order_acq_rel);
+				}
+				else
+				{
+					/*
+					** Grab the data before unlinking; once head moves the node may be
+					** recycled. A torn read here is discarded when the exchange fails.
+					*/
+					payload_t data = *std::launder(reinterpret_cast<const payload_t*>(_nodes[detail::link_index(next)].data));
+
+					/* Attempt to pop the node. Leave the loop on success. */
+					uint64_t link = detail::make_link(detail::link_index(next), detail::link_count(head) + 1);
+					if (_head.compare_exchange_strong(head, link, std::memory_order_acq_rel))
+					{
+						_count.add(-1);
+						_free_node_index(detail::link_index(head));
+
+						if (retry_count)
+						{
+							VTRACE_HOOK_COUNTER("vqueue_pop retries", retry_count);
+						}
+						return data;
+					}
+				}
+			}
+		}
+
+		force_inline uint32_t _alloc_node_index()
+		{
+			bool is_full = false;
+			uint64_t free_list = _free_list.load(std::memory_order_acquire);
+			for (;;)
+			{
+				uint32_t index = detail::link_index(free_list);
+				if (index == detail::k_invalid_index)
+				{
+					if (!is_full)
+					{
+						is_full = true;
+						VTRACE_HOOK_BEGIN("vqueue full");
+					}
+					free_list = _free_list.load(std::memory_order_acquire);
+					continue;
+				}
+
+				uint64_t next = _nodes[index].next.load(std::memory_order_relaxed);
+				uint64_t link = detail::make_link(detail::link_index(next), detail::link_count(free_list) + 1);
+				if (_free_list.compare_exchange_weak(free_list, link, std::memory_order_acquire, std::memory_order_acquire))
+				{
+					if (is_full)
+					{
+						VTRACE_HOOK_END("vqueue full");
+					}
+					return index;
+				}
+			}
+		}
+
+		force_inline void _free_node_index(uint32_t index)
+		{
+			std::atomic<uint64_t>& node_next = _nodes[index].next;
+			uint64_t free_list = _free_list.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				uint64_t next = node_next.load(std::memory_order_relaxed);
+				node_next.store(detail::make_link(detail::link_index(free_list), detail::link_count(next)), std::memory_order_relaxed);
+
+				uint64_t link = detail::make_link(index, detail::link_count(free_list) + 1);
+				if (_free_list.compare_exchange_weak(free_list, link, std::memory_order_release, std::memory_order_relaxed))
+				{
+					return;
+				}
+			}
+		}
+
+		alignas(VCACHE_LINE_SIZE) std::atomic<uint64_t> _head;
+		alignas(VCACHE_LINE_SIZE) std::atomic<uint64_t> _tail;
+		alignas(VCACHE_LINE_SIZE) std::atomic<uint64_t> _free_list;
+		alignas(VCACHE_LINE_SIZE) node_t _nodes[k_node_count];
+		detail::queue_slots<T, N, k_inline_data> _slots;
+		count_t _count;
+	};
+}
@@ -23,6 +23,10 @@
 #include "containers/vqueue.h"
 
 #include "thread/vatomic.h"
+#include "thread/vcounter.h"
+#include "thread/vtrace.h"
+
+/* The algorithm is duplicated in viper::queue (containers/vqueue.hpp); change both together. */
 
 typedef struct _vqueue_nodecount_t
 {
@@ -48,29 +52,60 @@ typedef struct _vqueue_impl_t
 	vqueue_pointer_t tail;
 	vqueue_pointer_t free_list;
 
-	int32_t count;
+#if !defined(VQUEUE_NO_COUNT)
+	vcounter_t count;
+#endif
 
 	vqueue_node_t* nodes;
 } vqueue_impl_t;
 
 static const uint32_t k_vqueue_invalid_index = 0xffffffff;
 
+#if !defined(VQUEUE_NO_COUNT)
+/* Shards used by the element counter, so push and pop don't contend on one line. */
+static const int k_vqueue_count_shards = 16;
+#endif
+
 static uint32_t _alloc_node_index(vqueue_impl_t* queue);
 static void _free_node_index(vqueue_impl_t* queue, uint32_t index);
 static vqueue_node_t* _init_node(vqueue_impl_t* queue, uint32_t node_index);
+static force_inline vqueue_pointer_t _load_pointer(const vqueue_pointer_t* pointer);
 
 size_t vqueue_get_bytes_required(int node_count)
 {
-	return sizeof(vqueue_impl_t) + (sizeof(vqueue_node_t) * node_count);
+	return vqueue_get_bytes_required_ex(node_count, 0);
 }
 
 vqueue_t vqueue_create(void* buffer, int node_count)
+{
+	return vqueue_create_ex(buffer, node_count, 0);
+}
+
+size_t vqueue_get_bytes_required_ex(int node_count, uint32_t flags)
+{
+	size_t bytes = sizeof(vqueue_impl_t) + (sizeof(vqueue_node_t) * node_count);
+#if !defined(VQUEUE_NO_COUNT)
+	if (!(flags & k_vqueue_flag_no_count))
+	{
+		bytes += vcounter_get_bytes_required(k_vqueue_count_shards);
+	}
+#else
+	(void)flags;
+#endif
+	return bytes;
+}
+
+vqueue_t vqueue_create_ex(void* buffer, int node_count, uint32_t flags)
 {
 	vqueue_impl_t* queue = (vqueue_impl_t*)buffer;
 
-	queue->count = 0;
 	queue->free_list.entire = 0;
 	queue->nodes = (vqueue_node_t*)(queue + 1);
+#if !defined(VQUEUE_NO_COUNT)
+	queue->count = (flags & k_vqueue_flag_no_count) ? NULL : vcounter_create(queue->nodes + node_count, k_vqueue_count_shards);
+#else
+	(void)flags;
+#endif
 
 	/* Link nodes together. */
 	for (int i = 0; i < node_count - 1; ++i)
@@ -103,15 +138,17 @@ void vqueue_push(vqueue_t q, void* data)
 	node->data = data;
 
 	vqueue_pointer_t tail;
+	int retry_count = -1;
 
 	/* Try until the push succeeds. */
 	for (;;)
 	{
-		tail = queue->tail;
-		vqueue_pointer_t next = queue->nodes[tail.part.index].next;
+		++retry_count;
+		tail = _load_pointer(&queue->tail);
+		vqueue_pointer_t next = _load_pointer(&queue->nodes[tail.part.index].next);
 
 		/* Is our view of the queue still consistent? If not, try again. */
-		if (tail.entire == queue->tail.entire)
+		if (tail.entire == _load_pointer(&queue->tail).entire)
 		{
 			/* Is tail pointing to last node? */
 			if (next.part.index == k_vqueue_invalid_index)
@@ -137,7 +174,18 @@ void vqueue_push(vqueue_t q, void* data)
 	{
 		vqueue_pointer_t link = { .part.index = node_index, .part.count = tail.part.count + 1 };
 		vatomic64_compare_exchange(&queue->tail.entire, tail.entire, link.entire);
-		vatomic32_increment(&queue->count);
+	}
+
+#if !defined(VQUEUE_NO_COUNT)
+	if (queue->count)
+	{
+		vcounter_increment(queue->count);
+	}
+#endif
+
+	if (retry_count)
+	{
+		VTRACE_HOOK_COUNTER("vqueue_push retries", retry_count);
 	}
 }
 
@@ -145,15 +193,17 @@ bool vqueue_pop(vqueue_t q, void** data)
 {
 	vqueue_impl_t* queue = (vqueue_impl_t*)(q);
 	vqueue_pointer_t head;
+	int retry_count = -1;
 
 	for (;;)
 	{
-		head = queue->head;
-		vqueue_pointer_t tail = queue->tail;
-		vqueue_pointer_t next = queue->nodes[head.part.index].next;
+		++retry_count;
+		head = _load_pointer(&queue->head);
+		vqueue_pointer_t tail = _load_pointer(&queue->tail);
+		vqueue_pointer_t next = _load_pointer(&queue->nodes[head.part.index].next);
 
 		/* Is our view of the queue still consistent? If not, try again. */
-		if (head.entire == queue->head.entire)
+		if (head.entire == _load_pointer(&queue->head).entire)
 		{
 			if (head.part.index == tail.part.index)
 			{
@@ -182,29 +232,45 @@ bool vqueue_pop(vqueue_t q, void** data)
 		}
 	}
 
-	vatomic32_decrement(&queue->count);
+#if !defined(VQUEUE_NO_COUNT)
+	if (queue->count)
+	{
+		vcounter_decrement(queue->count);
+	}
+#endif
 	_free_node_index(queue, head.part.index);
+
+	if (retry_count)
+	{
+		VTRACE_HOOK_COUNTER("vqueue_pop retries", retry_count);
+	}
 	return true;
 }
 
 int vqueue_get_count(vqueue_t q)
 {
+#if !defined(VQUEUE_NO_COUNT)
 	vqueue_impl_t* queue = (vqueue_impl_t*)(q);
-	return queue->count;
+	return queue->count ? (int)vcounter_get(queue->count) : -1;
+#else
+	(void)q;
+	return -1;
+#endif
 }
 
 static uint32_t _alloc_node_index(vqueue_impl_t* queue)
 {
 	uint32_t index;
+	bool is_full = false;
 
 	for (;;)
 	{
-		vqueue_pointer_t free_list = queue->free_list;
+		vqueue_pointer_t free_list = _load_pointer(&queue->free_list);
 
 		if (free_list.part.index != k_vqueue_invalid_index)
 		{
 			index = free_list.part.index;
-			vqueue_pointer_t next = queue->nodes[index].next;
+			vqueue_pointer_t next = _load_pointer(&queue->nodes[index].next);
 
 			vqueue_pointer_t link = { .part.index = next.part.index, .part.count = free_list.part.count + 1 };
 			if (vatomic64_compare_exchange(&queue->free_list.entire, free_list.entire, link.entire) == free_list.entire)
@@ -212,8 +278,17 @@ static uint32_t _alloc_node_index(vqueue_impl_t* queue)
 				break;
 			}
 		}
+		else if (!is_full)
+		{
+			is_full = true;
+			VTRACE_HOOK_BEGIN("vqueue full");
+		}
 	}
 
+	if (is_full)
+	{
+		VTRACE_HOOK_END("vqueue full");
+	}
 	return index;
 }
 
@@ -222,7 +297,7 @@ static void _free_node_index(vqueue_impl_t* queue, uint32_t index)
 	vqueue_node_t* node = queue->nodes + index;
 	for (;;)
 	{
-		vqueue_pointer_t free_list = queue->free_list;
+		vqueue_pointer_t free_list = _load_pointer(&queue->free_list);
 		node->next.part.index = free_list.part.index;
 
 		vqueue_pointer_t link = { .part.index = index, .part.count = free_list.part.count + 1 };
@@ -244,3 +319,15 @@ static vqueue_node_t* _init_node(vqueue_impl_t* queue, uint32_t node_index)
 
 	return node;
 }
+
+static force_inline vqueue_pointer_t _load_pointer(const vqueue_pointer_t* pointer)
+{
+	/*
+	** Shared pointers must be reloaded on every pass. A plain load lets the
+	** compiler hoist it out of a spin loop, or fold the consistency re-check
+	** into the first load.
+	*/
+	vqueue_pointer_t result;
+	result.entire = (uint64_t)vatomic64_load((const int64_t*)&pointer->entire);
+	return result;
+}
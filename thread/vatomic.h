@@ -30,6 +30,20 @@
 extern "C" {
 #endif
 
+	/*
+	** Load a value atomically, with acquire ordering.
+	** @param store Address of the value to load.
+	** @return The value at *store.
+	*/
+	int32_t vatomic32_load(const int32_t* store);
+
+	/*
+	** Store a value atomically, with release ordering. Cheaper than vatomic32_exchange.
+	** @param store Destination storage.
+	** @param value Value to store.
+	*/
+	void vatomic32_store(int32_t* store, int32_t value);
+
 	/*
 	** Compare two values atomically, and if equal, store a third value.
 	** @param store Address of first value to compare, and destination storage if equal.
@@ -69,6 +83,20 @@ extern "C" {
 	*/
 	int32_t vatomic32_decrement(int32_t* store);
 
+	/*
+	** Load a value atomically, with acquire ordering.
+	** @param store Address of the value to load.
+	** @return The value at *store.
+	*/
+	int64_t vatomic64_load(const int64_t* store);
+
+	/*
+	** Store a value atomically, with release ordering. Cheaper than vatomic64_exchange.
+	** @param store Destination storage.
+	** @param value Value to store.
+	*/
+	void vatomic64_store(int64_t* store, int64_t value);
+
 	/*
 	** Compare two values atomically, and if equal, store a third value.
 	** @param store Address of first value to compare, and destination storage if equal.
@@ -113,6 +141,21 @@ extern "C" {
 	*/
 	void vatomic_barrier();
 
+	/*
+	** Keep loads before the fence from being reordered with loads and stores after it.
+	*/
+	void vatomic_acquire_fence();
+
+	/*
+	** Keep loads and stores before the fence from being reordered with stores after it.
+	*/
+	void vatomic_release_fence();
+
+	/*
+	** Hint to the CPU that the caller is spinning, e.g. waiting on a lock.
+	*/
+	void vatomic_pause();
+
 #ifdef __cplusplus
 }
 #endif
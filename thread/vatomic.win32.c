@@ -26,6 +26,21 @@
 #include <windows.h>
 #undef WIN32_LEAN_AND_MEAN
 
+int32_t vatomic32_load(const int32_t* store)
+{
+	/* Aligned loads are atomic, and x86/x64 loads already have acquire semantics. */
+	int32_t value = *(const volatile int32_t*)store;
+	_ReadWriteBarrier();
+	return value;
+}
+
+void vatomic32_store(int32_t* store, int32_t value)
+{
+	/* Aligned stores are atomic, and x86/x64 stores already have release semantics. */
+	_ReadWriteBarrier();
+	*(volatile int32_t*)store = value;
+}
+
 int32_t vatomic32_compare_exchange(int32_t* store, int32_t comp, int32_t value)
 {
 	return _InterlockedCompareExchange((volatile long*)store, value, comp);
@@ -51,6 +66,29 @@ int32_t vatomic32_decrement(int32_t* store)
 	return _InterlockedDecrement((volatile long*)store) + 1;
 }
 
+int64_t vatomic64_load(const int64_t* store)
+{
+#if defined(_M_IX86)
+	/* 64-bit loads are not atomic on 32-bit x86. */
+	return _InterlockedCompareExchange64((volatile __int64*)store, 0, 0);
+#else
+	int64_t value = *(const volatile int64_t*)store;
+	_ReadWriteBarrier();
+	return value;
+#endif
+}
+
+void vatomic64_store(int64_t* store, int64_t value)
+{
+#if defined(_M_IX86)
+	/* 64-bit stores are not atomic on 32-bit x86. */
+	_InterlockedExchange64((volatile __int64*)store, value);
+#else
+	_ReadWriteBarrier();
+	*(volatile int64_t*)store = value;
+#endif
+}
+
 int64_t vatomic64_compare_exchange(int64_t* store, int64_t comp, int64_t value)
 {
 	return _InterlockedCompareExchange64((volatile __int64*)store, value, comp);
@@ -81,3 +119,28 @@ void vatomic_barrier()
 	int32_t unused = 0;
 	vatomic32_exchange(&unused, 1);
 }
+
+void vatomic_acquire_fence()
+{
+#if defined(_M_ARM64)
+	__dmb(_ARM64_BARRIER_ISHLD);
+#else
+	/* x86/x64 does not reorder loads with later loads or stores. */
+	_ReadWriteBarrier();
+#endif
+}
+
+void vatomic_release_fence()
+{
+#if defined(_M_ARM64)
+	__dmb(_ARM64_BARRIER_ISH);
+#else
+	/* x86/x64 does not reorder stores with earlier loads or stores. */
+	_ReadWriteBarrier();
+#endif
+}
+
+void vatomic_pause()
+{
+	YieldProcessor();
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+/*
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to
+** deal in the Software without restriction, including without limitation the
+** rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+** sell copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+** IN THE SOFTWARE.
+**
+** Sharded counter. Updates go to the shard of the CPU the caller is running on,
+** each on its own cache line, so writers on different cores do not contend.
+** Reads sum all shards.
+*/
+
+#include "vbase.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Handle to sharded counter. */
+typedef void* vcounter_t;
+
+/*
+** Gets the amount of memory required by a counter with the specified number of shards.
+** @param shard_count Number of shards. Rounded up to a power of two.
+** @return The amount of memory required.
+** @see vcounter_create
+*/
+size_t vcounter_get_bytes_required(int shard_count);
+
+/*
+** Create a sharded counter, initialized to zero.
+** @param buffer A buffer of size vcounter_get_bytes_required().
+** @param shard_count Number of shards. Rounded up to a power of two.
+** @return A new counter.
+** @see vcounter_get_bytes_required
+*/
+vcounter_t vcounter_create(void* buffer, int shard_count);
+
+/*
+** Add a value to the current CPU's shard of the counter.
+** @param counter The counter to update.
+** @param value Value to add. May be negative.
+*/
+void vcounter_add(vcounter_t counter, int64_t value);
+
+/*
+** Increment the counter.
+** @param counter The counter to increment.
+*/
+void vcounter_increment(vcounter_t counter);
+
+/*
+** Decrement the counter.
+** @param counter The counter to decrement.
+*/
+void vcounter_decrement(vcounter_t counter);
+
+/*
+** Get the value of the counter by summing all shards. Exact if there are no
+** concurrent updates, otherwise includes some subset of the in-flight updates.
+** @param counter The counter to read.
+** @return The sum of all shards.
+*/
+int64_t vcounter_get(vcounter_t counter);
+
+/*
+** Reset the counter to zero. Not safe to call concurrently with updates.
+** @param counter The counter to reset.
+*/
+void vcounter_reset(vcounter_t counter);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,122 @@
+#pragma once
+
+/*
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to
+** deal in the Software without restriction, including without limitation the
+** rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+** sell copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+** IN THE SOFTWARE.
+**
+** Sharded counter, C++ front-end with compile-time shard count.
+** Same scheme as vcounter, but storage is embedded in the object and every
+** operation is inlined into the caller.
+*/
+
+#include "vbase.h"
+
+#include <atomic>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace viper
+{
+	namespace detail
+	{
+#if !defined(__linux__)
+		/* Source of per-thread shard indices, where the current CPU can't be queried from a header. */
+		inline std::atomic<uint32_t> g_counter_next_thread_slot(0);
+		inline thread_local uint32_t t_counter_thread_slot = 0xffffffff;
+#endif
+
+		/* Index used to pick a shard. Matches vcounter: the current CPU where available. */
+		force_inline uint32_t counter_shard_index()
+		{
+#if defined(__linux__)
+			return (uint32_t)sched_getcpu();
+#else
+			if (t_counter_thread_slot == 0xffffffff)
+			{
+				t_counter_thread_slot = g_counter_next_thread_slot.fetch_add(1, std::memory_order_relaxed) & 0x7fffffff;
+			}
+			return t_counter_thread_slot;
+#endif
+		}
+	}
+
+	/*
+	** Counter with N cache-line padded shards, updated with relaxed atomic
+	** adds to the shard of the current CPU.
+	** Thread-safe. Not copyable or movable.
+	*/
+	template <uint32_t N>
+	class counter
+	{
+		static_assert(N > 0 && (N & (N - 1)) == 0, "counter shard count must be a power of two");
+
+	public:
+		counter()
+		{
+			reset();
+		}
+
+		counter(const counter&) = delete;
+		counter& operator=(const counter&) = delete;
+
+		/*
+		** Add a value to the current CPU's shard of the counter.
+		** @param value Value to add. May be negative.
+		*/
+		force_inline void add(int64_t value)
+		{
+			_shards[detail::counter_shard_index() & (N - 1)].value.fetch_add(value, std::memory_order_relaxed);
+		}
+
+		/*
+		** Get the value of the counter by summing all shards. Exact if there are
+		** no concurrent updates.
+		*/
+		force_inline int64_t get() const
+		{
+			int64_t sum = 0;
+			for (uint32_t i = 0; i < N; ++i)
+			{
+				sum += _shards[i].value.load(std::memory_order_relaxed);
+			}
+			return sum;
+		}
+
+		/* Reset the counter to zero. Not safe to call concurrently with updates. */
+		void reset()
+		{
+			for (uint32_t i = 0; i < N; ++i)
+			{
+				_shards[i].value.store(0, std::memory_order_relaxed);
+			}
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+		}
+
+	private:
+		struct alignas(VCACHE_LINE_SIZE) shard_t
+		{
+			std::atomic<int64_t> value;
+		};
+
+		shard_t _shards[N];
+	};
+}
@@ -0,0 +1,154 @@
+/*
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to
+** deal in the Software without restriction, including without limitation the
+** rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+** sell copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+** IN THE SOFTWARE.
+*/
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "thread/vcounter.h"
+
+#include "thread/vatomic.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#undef WIN32_LEAN_AND_MEAN
+#elif defined(__linux__)
+#include <sched.h>
+#endif
+
+typedef struct _vcounter_shard_t
+{
+	int64_t value;
+	char padding[VCACHE_LINE_SIZE - sizeof(int64_t)];
+} vcounter_shard_t;
+
+typedef struct _vcounter_impl_t
+{
+	uint32_t shard_mask;
+
+	vcounter_shard_t* shards;
+} vcounter_impl_t;
+
+#if !defined(_WIN32) && !defined(__linux__)
+/* Source of per-thread shard indices, where the current CPU can't be queried. */
+static int32_t s_vcounter_next_thread_slot = 0;
+static __thread int32_t t_vcounter_thread_slot = -1;
+#endif
+
+static uint32_t _round_up_pow2(uint32_t value);
+static vcounter_shard_t* _get_shard(vcounter_impl_t* counter);
+
+size_t vcounter_get_bytes_required(int shard_count)
+{
+	/* Extra cache line so the shards can be aligned within the buffer. */
+	return sizeof(vcounter_impl_t) + VCACHE_LINE_SIZE + (sizeof(vcounter_shard_t) * _round_up_pow2(shard_count));
+}
+
+vcounter_t vcounter_create(void* buffer, int shard_count)
+{
+	vcounter_impl_t* counter = (vcounter_impl_t*)buffer;
+
+	uintptr_t shards = (uintptr_t)(counter + 1);
+	shards = (shards + VCACHE_LINE_SIZE - 1) & ~(uintptr_t)(VCACHE_LINE_SIZE - 1);
+
+	counter->shard_mask = _round_up_pow2(shard_count) - 1;
+	counter->shards = (vcounter_shard_t*)shards;
+
+	vcounter_reset(counter);
+
+	return counter;
+}
+
+void vcounter_add(vcounter_t c, int64_t value)
+{
+	vcounter_impl_t* counter = (vcounter_impl_t*)(c);
+	vatomic64_exchange_add(&_get_shard(counter)->value, value);
+}
+
+void vcounter_increment(vcounter_t c)
+{
+	vcounter_impl_t* counter = (vcounter_impl_t*)(c);
+	vatomic64_increment(&_get_shard(counter)->value);
+}
+
+void vcounter_decrement(vcounter_t c)
+{
+	vcounter_impl_t* counter = (vcounter_impl_t*)(c);
+	vatomic64_decrement(&_get_shard(counter)->value);
+}
+
+int64_t vcounter_get(vcounter_t c)
+{
+	vcounter_impl_t* counter = (vcounter_impl_t*)(c);
+
+	int64_t sum = 0;
+	for (uint32_t i = 0; i <= counter->shard_mask; ++i)
+	{
+		sum += vatomic64_load(&counter->shards[i].value);
+	}
+	return sum;
+}
+
+void vcounter_reset(vcounter_t c)
+{
+	vcounter_impl_t* counter = (vcounter_impl_t*)(c);
+
+	for (uint32_t i = 0; i <= counter->shard_mask; ++i)
+	{
+		counter->shards[i].value = 0;
+	}
+
+	vatomic_barrier();
+}
+
+static uint32_t _round_up_pow2(uint32_t value)
+{
+	uint32_t result = 1;
+	while (result < value)
+	{
+		result <<= 1;
+	}
+	return result;
+}
+
+static vcounter_shard_t* _get_shard(vcounter_impl_t* counter)
+{
+	/*
+	** Shard by CPU rather than by thread, so every thread, however many have
+	** come and gone, lands on a line that is normally only touched from its own
+	** core. A thread that migrates mid-update just shares a line briefly, which
+	** the atomic add tolerates.
+	*/
+#if defined(_WIN32)
+	uint32_t index = (uint32_t)GetCurrentProcessorNumber();
+#elif defined(__linux__)
+	uint32_t index = (uint32_t)sched_getcpu();
+#else
+	if (t_vcounter_thread_slot < 0)
+	{
+		t_vcounter_thread_slot = vatomic32_increment(&s_vcounter_next_thread_slot) & 0x7fffffff;
+	}
+	uint32_t index = (uint32_t)t_vcounter_thread_slot;
+#endif
+	return counter->shards + (index & counter->shard_mask);
+}
@@ -0,0 +1,241 @@
+/*
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to
+** deal in the Software without restriction, including without limitation the
+** rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+** sell copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+** IN THE SOFTWARE.
+*/
+
+/*
+** Benchmark of the vlock family against pthread_mutex and pthread_rwlock,
+** under varying thread counts and critical section lengths. POSIX only.
+**
+** cc -O2 -std=c11 -I. thread/vlock.bench.c thread/vlock.impl.c thread/vatomic.gcc.c -lpthread
+*/
+
+#define _GNU_SOURCE
+
+#include "thread/vlock.h"
+
+#include "thread/vatomic.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+
+typedef enum _bench_lock_type_t
+{
+	k_bench_pthread_mutex,
+	k_bench_ticket,
+	k_bench_mcs,
+	k_bench_rwlock_spin,
+	k_bench_rwlock_sleep,
+	k_bench_pthread_rwlock,
+	k_bench_lock_type_count,
+} bench_lock_type_t;
+
+static const char* k_bench_lock_names[] =
+{
+	"pthread_mutex",
+	"vticketlock",
+	"vmcslock",
+	"vrwlock (spin)",
+	"vrwlock (sleep)",
+	"pthread_rwlock",
+};
+
+static const int k_bench_thread_counts[] = { 1, 2, 4, 8, 16 };
+static const int k_bench_critical_lengths[] = { 0, 100, 1000 };
+
+/* Milliseconds to run each configuration. */
+static const int k_bench_duration_ms = 200;
+
+/* Percentage of reader-writer lock acquisitions that are reads. */
+static const int k_bench_read_percent = 90;
+
+typedef struct _bench_t
+{
+	bench_lock_type_t type;
+	int critical_length;
+
+	int32_t is_started;
+	int32_t is_stopped;
+
+	pthread_mutex_t mutex;
+	pthread_rwlock_t rwlock;
+	vticketlock_t ticket;
+	vmcslock_t mcs;
+	vrwlock_t vrw;
+
+	/* Protected by the lock under test. */
+	volatile int64_t shared_counter;
+
+	int64_t total_ops;
+	int64_t total_writes;
+} bench_t;
+
+static void _critical_section(bench_t* bench, bool is_write)
+{
+	for (int i = 0; i < bench->critical_length; ++i)
+	{
+		(void)bench->shared_counter;
+	}
+	if (is_write)
+	{
+		bench->shared_counter = bench->shared_counter + 1;
+	}
+}
+
+static void* _bench_thread(void* arg)
+{
+	bench_t* bench = (bench_t*)arg;
+	vmcslock_node_t node;
+	uint32_t random = (uint32_t)(uintptr_t)&node;
+	int64_t ops = 0;
+	int64_t writes = 0;
+
+	while (!vatomic32_load(&bench->is_started))
+	{
+		vatomic_pause();
+	}
+
+	while (!vatomic32_load(&bench->is_stopped))
+	{
+		random = random * 1664525 + 1013904223;
+		bool is_write = (int)((random >> 8) % 100) >= k_bench_read_percent;
+
+		switch (bench->type)
+		{
+		case k_bench_pthread_mutex:
+			pthread_mutex_lock(&bench->mutex);
+			_critical_section(bench, true);
+			pthread_mutex_unlock(&bench->mutex);
+			is_write = true;
+			break;
+		case k_bench_ticket:
+			vticketlock_lock(bench->ticket);
+			_critical_section(bench, true);
+			vticketlock_unlock(bench->ticket);
+			is_write = true;
+			break;
+		case k_bench_mcs:
+			vmcslock_lock(bench->mcs, &node);
+			_critical_section(bench, true);
+			vmcslock_unlock(bench->mcs, &node);
+			is_write = true;
+			break;
+		case k_bench_rwlock_spin:
+		case k_bench_rwlock_sleep:
+			if (is_write)
+			{
+				vrwlock_write_lock(bench->vrw);
+				_critical_section(bench, true);
+				vrwlock_write_unlock(bench->vrw);
+			}
+			else
+			{
+				vrwlock_read_lock(bench->vrw);
+				_critical_section(bench, false);
+				vrwlock_read_unlock(bench->vrw);
+			}
+			break;
+		default:
+			if (is_write)
+			{
+				pthread_rwlock_wrlock(&bench->rwlock);
+				_critical_section(bench, true);
+				pthread_rwlock_unlock(&bench->rwlock);
+			}
+			else
+			{
+				pthread_rwlock_rdlock(&bench->rwlock);
+				_critical_section(bench, false);
+				pthread_rwlock_unlock(&bench->rwlock);
+			}
+			break;
+		}
+
+		++ops;
+		writes += is_write;
+	}
+
+	vatomic64_exchange_add(&bench->total_ops, ops);
+	vatomic64_exchange_add(&bench->total_writes, writes);
+	return NULL;
+}
+
+static void _sleep_ms(int ms)
+{
+	struct timespec duration = { ms / 1000, (ms % 1000) * 1000000 };
+	nanosleep(&duration, NULL);
+}
+
+int main()
+{
+	static char ticket_buffer[256];
+	static char mcs_buffer[256];
+	static char vrw_buffer[256];
+
+	printf("%-16s %8s %8s %14s\n", "lock", "threads", "cs", "ops/ms");
+
+	for (int type = 0; type < k_bench_lock_type_count; ++type)
+	{
+		for (int c = 0; c < _countof(k_bench_critical_lengths); ++c)
+		{
+			for (int t = 0; t < _countof(k_bench_thread_counts); ++t)
+			{
+				bench_t bench = { 0 };
+				bench.type = (bench_lock_type_t)type;
+				bench.critical_length = k_bench_critical_lengths[c];
+				pthread_mutex_init(&bench.mutex, NULL);
+				pthread_rwlock_init(&bench.rwlock, NULL);
+				bench.ticket = vticketlock_create(ticket_buffer);
+				bench.mcs = vmcslock_create(mcs_buffer);
+				bench.vrw = vrwlock_create(vrw_buffer, type == k_bench_rwlock_sleep ? 100 : -1);
+
+				int thread_count = k_bench_thread_counts[t];
+				pthread_t threads[16];
+				for (int i = 0; i < thread_count; ++i)
+				{
+					pthread_create(&threads[i], NULL, _bench_thread, &bench);
+				}
+
+				vatomic32_exchange(&bench.is_started, 1);
+				_sleep_ms(k_bench_duration_ms);
+				vatomic32_exchange(&bench.is_stopped, 1);
+
+				for (int i = 0; i < thread_count; ++i)
+				{
+					pthread_join(threads[i], NULL);
+				}
+
+				if (bench.shared_counter != bench.total_writes)
+				{
+					printf("%s: lost updates, %lld != %lld\n", k_bench_lock_names[type], (long long)bench.shared_counter, (long long)bench.total_writes);
+					return 1;
+				}
+
+				printf("%-16s %8d %8d %14.1f\n", k_bench_lock_names[type], thread_count, bench.critical_length, (double)bench.total_ops / k_bench_duration_ms);
+
+				pthread_rwlock_destroy(&bench.rwlock);
+				pthread_mutex_destroy(&bench.mutex);
+			}
+		}
+	}
+
+	return 0;
+}
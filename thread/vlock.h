@@ -0,0 +1,180 @@
+#pragma once
+
+/*
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to
+** deal in the Software without restriction, including without limitation the
+** rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+** sell copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+** IN THE SOFTWARE.
+**
+** Spin locks for short critical sections.
+** * vticketlock - FIFO fair lock.
+** * vmcslock - Queue lock where each waiter spins on its own cache line.
+**   http://www.cs.rochester.edu/u/scott/papers/1991_TOCS_synch.pdf
+** * vrwlock - Writer-preferring reader-writer lock, optionally sleeping after spinning.
+*/
+
+#include "vbase.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Handle to ticket lock. */
+typedef void* vticketlock_t;
+
+/*
+** Gets the amount of memory required by a ticket lock.
+** @return The amount of memory required.
+** @see vticketlock_create
+*/
+size_t vticketlock_get_bytes_required();
+
+/*
+** Create a ticket lock, initially unlocked.
+** @param buffer A buffer of size vticketlock_get_bytes_required().
+** @return A new ticket lock.
+** @see vticketlock_get_bytes_required
+*/
+vticketlock_t vticketlock_create(void* buffer);
+
+/*
+** Acquire the lock. Spins until the lock is acquired; waiters acquire in arrival order.
+** @param lock The lock to acquire.
+** @see vticketlock_unlock
+*/
+void vticketlock_lock(vticketlock_t lock);
+
+/*
+** Acquire the lock if it is free.
+** @param lock The lock to acquire.
+** @return If the lock was acquired, true is returned.
+** @see vticketlock_unlock
+*/
+bool vticketlock_try_lock(vticketlock_t lock);
+
+/*
+** Release the lock.
+** @param lock The lock to release.
+** @see vticketlock_lock
+*/
+void vticketlock_unlock(vticketlock_t lock);
+
+/* Handle to MCS queue lock. */
+typedef void* vmcslock_t;
+
+/*
+** Per-acquisition queue entry for an MCS lock, usually on the stack.
+** Aligned to a cache line, so waiters don't share the line they spin on.
+*/
+typedef struct VCACHE_ALIGNED _vmcslock_node_t
+{
+	int64_t next;
+	int32_t is_waiting;
+} vmcslock_node_t;
+
+/*
+** Gets the amount of memory required by an MCS lock.
+** @return The amount of memory required.
+** @see vmcslock_create
+*/
+size_t vmcslock_get_bytes_required();
+
+/*
+** Create an MCS lock, initially unlocked.
+** @param buffer A buffer of size vmcslock_get_bytes_required().
+** @return A new MCS lock.
+** @see vmcslock_get_bytes_required
+*/
+vmcslock_t vmcslock_create(void* buffer);
+
+/*
+** Acquire the lock. Spins until the lock is acquired; waiters acquire in arrival order.
+** @param lock The lock to acquire.
+** @param node Queue entry owned by the caller until the matching vmcslock_unlock.
+** @see vmcslock_unlock
+*/
+void vmcslock_lock(vmcslock_t lock, vmcslock_node_t* node);
+
+/*
+** Acquire the lock if it is free.
+** @param lock The lock to acquire.
+** @param node Queue entry owned by the caller until the matching vmcslock_unlock.
+** @return If the lock was acquired, true is returned.
+** @see vmcslock_unlock
+*/
+bool vmcslock_try_lock(vmcslock_t lock, vmcslock_node_t* node);
+
+/*
+** Release the lock.
+** @param lock The lock to release.
+** @param node The node passed to vmcslock_lock.
+** @see vmcslock_lock
+*/
+void vmcslock_unlock(vmcslock_t lock, vmcslock_node_t* node);
+
+/* Handle to reader-writer lock. */
+typedef void* vrwlock_t;
+
+/*
+** Gets the amount of memory required by a reader-writer lock.
+** @return The amount of memory required.
+** @see vrwlock_create
+*/
+size_t vrwlock_get_bytes_required();
+
+/*
+** Create a reader-writer lock, initially unlocked. New readers wait while a
+** writer is waiting, so writers are not starved.
+** @param buffer A buffer of size vrwlock_get_bytes_required().
+** @param spin_count Number of spins before a waiter sleeps in the OS. If negative, waiters never sleep.
+** @return A new reader-writer lock.
+** @see vrwlock_get_bytes_required
+*/
+vrwlock_t vrwlock_create(void* buffer, int spin_count);
+
+/*
+** Acquire the lock for reading, shared with other readers.
+** @param lock The lock to acquire.
+** @see vrwlock_read_unlock
+*/
+void vrwlock_read_lock(vrwlock_t lock);
+
+/*
+** Release the lock after reading.
+** @param lock The lock to release.
+** @see vrwlock_read_lock
+*/
+void vrwlock_read_unlock(vrwlock_t lock);
+
+/*
+** Acquire the lock for writing, exclusive of readers and other writers.
+** @param lock The lock to acquire.
+** @see vrwlock_write_unlock
+*/
+void vrwlock_write_lock(vrwlock_t lock);
+
+/*
+** Release the lock after writing.
+** @param lock The lock to release.
+** @see vrwlock_write_lock
+*/
+void vrwlock_write_unlock(vrwlock_t lock);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,346 @@
+/*
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to
+** deal in the Software without restriction, including without limitation the
+** rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+** sell copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+** IN THE SOFTWARE.
+*/
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "thread/vlock.h"
+
+#include "thread/vatomic.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#undef WIN32_LEAN_AND_MEAN
+#pragma comment(lib, "Synchronization.lib")
+#elif defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <sched.h>
+#endif
+
+typedef struct _vticketlock_impl_t
+{
+	int32_t next_ticket;
+
+	/* Waiters spin on now_serving; keep ticket grabs from invalidating it. */
+	char padding[VCACHE_LINE_SIZE - sizeof(int32_t)];
+	int32_t now_serving;
+} vticketlock_impl_t;
+
+typedef struct _vmcslock_impl_t
+{
+	/* Last node in the queue, or zero if unlocked. */
+	int64_t tail;
+} vmcslock_impl_t;
+
+typedef struct _vrwlock_impl_t
+{
+	/* Number of readers, plus k_vrwlock_writer while a writer holds the lock. */
+	int32_t state;
+	int32_t writer_wait_count;
+
+	/* Sleeping waiters wait for wake_sequence to change. */
+	int32_t wake_sequence;
+	int32_t sleeper_count;
+
+	int spin_count;
+} vrwlock_impl_t;
+
+static const int32_t k_vrwlock_writer = 0x40000000;
+
+static void _rwlock_wait(vrwlock_impl_t* lock, int* spins, bool (*can_proceed)(vrwlock_impl_t*));
+static void _rwlock_wake(vrwlock_impl_t* lock);
+static bool _rwlock_can_read(vrwlock_impl_t* lock);
+static bool _rwlock_can_write(vrwlock_impl_t* lock);
+static void _os_wait(int32_t* address, int32_t value);
+static void _os_wake_all(int32_t* address);
+
+size_t vticketlock_get_bytes_required()
+{
+	return sizeof(vticketlock_impl_t);
+}
+
+vticketlock_t vticketlock_create(void* buffer)
+{
+	vticketlock_impl_t* lock = (vticketlock_impl_t*)buffer;
+
+	lock->next_ticket = 0;
+	lock->now_serving = 0;
+
+	vatomic_barrier();
+
+	return lock;
+}
+
+void vticketlock_lock(vticketlock_t l)
+{
+	vticketlock_impl_t* lock = (vticketlock_impl_t*)(l);
+
+	/* Tickets wrap, so compare them in unsigned arithmetic. */
+	uint32_t ticket = (uint32_t)vatomic32_increment(&lock->next_ticket);
+	for (;;)
+	{
+		int32_t distance = (int32_t)(ticket - (uint32_t)vatomic32_load(&lock->now_serving));
+		if (!distance)
+		{
+			break;
+		}
+
+		/* Back off in proportion to our place in line, to cut traffic on now_serving. */
+		for (int i = 0; i < distance; ++i)
+		{
+			vatomic_pause();
+		}
+	}
+}
+
+bool vticketlock_try_lock(vticketlock_t l)
+{
+	vticketlock_impl_t* lock = (vticketlock_impl_t*)(l);
+
+	int32_t now_serving = vatomic32_load(&lock->now_serving);
+	int32_t next_ticket = (int32_t)((uint32_t)now_serving + 1);
+	return vatomic32_compare_exchange(&lock->next_ticket, now_serving, next_ticket) == now_serving;
+}
+
+void vticketlock_unlock(vticketlock_t l)
+{
+	vticketlock_impl_t* lock = (vticketlock_impl_t*)(l);
+
+	/* Only the holder writes now_serving, so no read-modify-write is needed. */
+	vatomic32_store(&lock->now_serving, (int32_t)((uint32_t)lock->now_serving + 1));
+}
+
+size_t vmcslock_get_bytes_required()
+{
+	return sizeof(vmcslock_impl_t);
+}
+
+vmcslock_t vmcslock_create(void* buffer)
+{
+	vmcslock_impl_t* lock = (vmcslock_impl_t*)buffer;
+
+	lock->tail = 0;
+
+	vatomic_barrier();
+
+	return lock;
+}
+
+void vmcslock_lock(vmcslock_t l, vmcslock_node_t* node)
+{
+	vmcslock_impl_t* lock = (vmcslock_impl_t*)(l);
+
+	node->next = 0;
+	node->is_waiting = 1;
+
+	/* Join the queue. If there was a previous waiter, link behind it and spin on our own node. */
+	vmcslock_node_t* previous = (vmcslock_node_t*)(intptr_t)vatomic64_exchange(&lock->tail, (int64_t)(intptr_t)node);
+	if (previous)
+	{
+		vatomic64_store(&previous->next, (int64_t)(intptr_t)node);
+		while (vatomic32_load(&node->is_waiting))
+		{
+			vatomic_pause();
+		}
+	}
+}
+
+bool vmcslock_try_lock(vmcslock_t l, vmcslock_node_t* node)
+{
+	vmcslock_impl_t* lock = (vmcslock_impl_t*)(l);
+
+	node->next = 0;
+	node->is_waiting = 0;
+
+	return vatomic64_compare_exchange(&lock->tail, 0, (int64_t)(intptr_t)node) == 0;
+}
+
+void vmcslock_unlock(vmcslock_t l, vmcslock_node_t* node)
+{
+	vmcslock_impl_t* lock = (vmcslock_impl_t*)(l);
+
+	vmcslock_node_t* next = (vmcslock_node_t*)(intptr_t)vatomic64_load(&node->next);
+	if (!next)
+	{
+		/* No known successor. If we are still the tail, the lock is now free. */
+		if (vatomic64_compare_exchange(&lock->tail, (int64_t)(intptr_t)node, 0) == (int64_t)(intptr_t)node)
+		{
+			return;
+		}
+
+		/* A successor is between joining the queue and linking to us. */
+		while (!(next = (vmcslock_node_t*)(intptr_t)vatomic64_load(&node->next)))
+		{
+			vatomic_pause();
+		}
+	}
+
+	/* Hand the lock directly to the successor. */
+	vatomic32_store(&next->is_waiting, 0);
+}
+
+size_t vrwlock_get_bytes_required()
+{
+	return sizeof(vrwlock_impl_t);
+}
+
+vrwlock_t vrwlock_create(void* buffer, int spin_count)
+{
+	vrwlock_impl_t* lock = (vrwlock_impl_t*)buffer;
+
+	lock->state = 0;
+	lock->writer_wait_count = 0;
+	lock->wake_sequence = 0;
+	lock->sleeper_count = 0;
+	lock->spin_count = spin_count;
+
+	vatomic_barrier();
+
+	return lock;
+}
+
+void vrwlock_read_lock(vrwlock_t l)
+{
+	vrwlock_impl_t* lock = (vrwlock_impl_t*)(l);
+	int spins = 0;
+
+	for (;;)
+	{
+		/* Give way to waiting writers. */
+		if (!vatomic32_load(&lock->writer_wait_count))
+		{
+			int32_t state = vatomic32_load(&lock->state);
+			if (!(state & k_vrwlock_writer) && vatomic32_compare_exchange(&lock->state, state, state + 1) == state)
+			{
+				break;
+			}
+		}
+
+		_rwlock_wait(lock, &spins, _rwlock_can_read);
+	}
+}
+
+void vrwlock_read_unlock(vrwlock_t l)
+{
+	vrwlock_impl_t* lock = (vrwlock_impl_t*)(l);
+
+	/* The last reader out lets writers in. */
+	if (vatomic32_decrement(&lock->state) == 1)
+	{
+		_rwlock_wake(lock);
+	}
+}
+
+void vrwlock_write_lock(vrwlock_t l)
+{
+	vrwlock_impl_t* lock = (vrwlock_impl_t*)(l);
+	int spins = 0;
+
+	vatomic32_increment(&lock->writer_wait_count);
+	while (vatomic32_compare_exchange(&lock->state, 0, k_vrwlock_writer) != 0)
+	{
+		_rwlock_wait(lock, &spins, _rwlock_can_write);
+	}
+	vatomic32_decrement(&lock->writer_wait_count);
+}
+
+void vrwlock_write_unlock(vrwlock_t l)
+{
+	vrwlock_impl_t* lock = (vrwlock_impl_t*)(l);
+
+	vatomic32_exchange_add(&lock->state, -k_vrwlock_writer);
+	_rwlock_wake(lock);
+}
+
+static void _rwlock_wait(vrwlock_impl_t* lock, int* spins, bool (*can_proceed)(vrwlock_impl_t*))
+{
+	if (lock->spin_count < 0 || *spins < lock->spin_count)
+	{
+		++*spins;
+		vatomic_pause();
+		return;
+	}
+
+	/*
+	** Read the sequence before checking the lock. A release after this point
+	** changes the sequence, so the OS wait returns immediately instead of
+	** missing the wake.
+	*/
+	int32_t sequence = vatomic32_load(&lock->wake_sequence);
+	vatomic32_increment(&lock->sleeper_count);
+	if (!can_proceed(lock))
+	{
+		_os_wait(&lock->wake_sequence, sequence);
+	}
+	vatomic32_decrement(&lock->sleeper_count);
+}
+
+static void _rwlock_wake(vrwlock_impl_t* lock)
+{
+	if (lock->spin_count >= 0)
+	{
+		vatomic32_increment(&lock->wake_sequence);
+		if (vatomic32_load(&lock->sleeper_count))
+		{
+			_os_wake_all(&lock->wake_sequence);
+		}
+	}
+}
+
+static bool _rwlock_can_read(vrwlock_impl_t* lock)
+{
+	return !vatomic32_load(&lock->writer_wait_count) && !(vatomic32_load(&lock->state) & k_vrwlock_writer);
+}
+
+static bool _rwlock_can_write(vrwlock_impl_t* lock)
+{
+	return vatomic32_load(&lock->state) == 0;
+}
+
+static void _os_wait(int32_t* address, int32_t value)
+{
+#if defined(_WIN32)
+	WaitOnAddress(address, &value, sizeof(value), INFINITE);
+#elif defined(__linux__)
+	syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+#else
+	(void)address;
+	(void)value;
+	sched_yield();
+#endif
+}
+
+static void _os_wake_all(int32_t* address)
+{
+#if defined(_WIN32)
+	WakeByAddressAll(address);
+#elif defined(__linux__)
+	syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, INT32_MAX, NULL, NULL, 0);
+#else
+	(void)address;
+#endif
+}
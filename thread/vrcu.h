@@ -0,0 +1,127 @@
+#pragma once
+
+/*
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to
+** deal in the Software without restriction, including without limitation the
+** rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+** sell copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+** IN THE SOFTWARE.
+**
+** Read-copy-update pointer publication, using quiescent-state based
+** reclamation. Readers load the current pointer with a single atomic load and
+** periodically announce a quiescent point, where they hold no references.
+** Writers publish a new version and free the old one once every reader has
+** passed a quiescent point. Readers only ever write their own cache line.
+*/
+
+#include "vbase.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Handle to RCU protected pointer. */
+typedef void* vrcu_t;
+
+/*
+** Gets the amount of memory required by an RCU pointer.
+** @param max_reader_count Maximum number of reader threads.
+** @return The amount of memory required.
+** @see vrcu_create
+*/
+size_t vrcu_get_bytes_required(int max_reader_count);
+
+/*
+** Create an RCU protected pointer.
+** @param buffer A buffer of size vrcu_get_bytes_required().
+** @param max_reader_count Maximum number of reader threads.
+** @param data Initial value of the pointer.
+** @return A new RCU pointer.
+** @see vrcu_get_bytes_required
+*/
+vrcu_t vrcu_create(void* buffer, int max_reader_count, void* data);
+
+/*
+** Register a reader thread. The reader starts online.
+** @param rcu The RCU pointer to read.
+** @return Index identifying the reader, or -1 if max_reader_count readers are registered.
+** @see vrcu_quiescent
+*/
+int vrcu_register_reader(vrcu_t rcu);
+
+/*
+** Read the current version of the pointer. The data remains valid until the
+** calling reader's next call to vrcu_quiescent or vrcu_offline.
+** @param rcu The RCU pointer to read.
+** @return The current pointer.
+*/
+void* vrcu_read(vrcu_t rcu);
+
+/*
+** Announce that the reader holds no pointers previously returned by vrcu_read.
+** Typically called once per frame or job.
+** @param rcu The RCU pointer.
+** @param reader Index returned by vrcu_register_reader.
+*/
+void vrcu_quiescent(vrcu_t rcu, int reader);
+
+/*
+** Take a reader offline, for example before it sleeps. Offline readers do not
+** hold up grace periods, and must not call vrcu_read.
+** @param rcu The RCU pointer.
+** @param reader Index returned by vrcu_register_reader.
+** @see vrcu_online
+*/
+void vrcu_offline(vrcu_t rcu, int reader);
+
+/*
+** Bring an offline reader back online.
+** @param rcu The RCU pointer.
+** @param reader Index returned by vrcu_register_reader.
+** @see vrcu_offline
+*/
+void vrcu_online(vrcu_t rcu, int reader);
+
+/*
+** Publish a new version of the pointer.
+** @param rcu The RCU pointer.
+** @param data The new pointer.
+** @param grace_period On return, the grace period that must elapse before the previous version can be freed.
+** @return The previous version of the pointer.
+** @see vrcu_poll
+** @see vrcu_synchronize
+*/
+void* vrcu_publish(vrcu_t rcu, void* data, int64_t* grace_period);
+
+/*
+** Check whether a grace period has elapsed, without blocking.
+** @param rcu The RCU pointer.
+** @param grace_period Value returned by vrcu_publish.
+** @return True if every online reader has passed a quiescent point since the publish.
+*/
+bool vrcu_poll(vrcu_t rcu, int64_t grace_period);
+
+/*
+** Spin until a grace period has elapsed.
+** @param rcu The RCU pointer.
+** @param grace_period Value returned by vrcu_publish.
+*/
+void vrcu_synchronize(vrcu_t rcu, int64_t grace_period);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,158 @@
+/*
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to
+** deal in the Software without restriction, including without limitation the
+** rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+** sell copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+** IN THE SOFTWARE.
+*/
+
+#include "thread/vrcu.h"
+
+#include "thread/vatomic.h"
+
+typedef struct _vrcu_reader_t
+{
+	/* Last epoch seen at a quiescent point, or zero while offline. */
+	int64_t epoch;
+	char padding[VCACHE_LINE_SIZE - sizeof(int64_t)];
+} vrcu_reader_t;
+
+typedef struct _vrcu_impl_t
+{
+	/* Read by every reader; written only by publishers. */
+	int64_t data;
+	int64_t epoch;
+	char padding[VCACHE_LINE_SIZE - (2 * sizeof(int64_t))];
+
+	int32_t reader_count;
+	int max_reader_count;
+
+	vrcu_reader_t* readers;
+} vrcu_impl_t;
+
+size_t vrcu_get_bytes_required(int max_reader_count)
+{
+	/* Extra cache line so the readers can be aligned within the buffer. */
+	return sizeof(vrcu_impl_t) + VCACHE_LINE_SIZE + (sizeof(vrcu_reader_t) * max_reader_count);
+}
+
+vrcu_t vrcu_create(void* buffer, int max_reader_count, void* data)
+{
+	vrcu_impl_t* rcu = (vrcu_impl_t*)buffer;
+
+	uintptr_t readers = (uintptr_t)(rcu + 1);
+	readers = (readers + VCACHE_LINE_SIZE - 1) & ~(uintptr_t)(VCACHE_LINE_SIZE - 1);
+
+	rcu->data = (int64_t)(intptr_t)data;
+	rcu->epoch = 1;
+	rcu->reader_count = 0;
+	rcu->max_reader_count = max_reader_count;
+	rcu->readers = (vrcu_reader_t*)readers;
+
+	for (int i = 0; i < max_reader_count; ++i)
+	{
+		rcu->readers[i].epoch = 0;
+	}
+
+	vatomic_barrier();
+
+	return rcu;
+}
+
+int vrcu_register_reader(vrcu_t r)
+{
+	vrcu_impl_t* rcu = (vrcu_impl_t*)(r);
+
+	int32_t reader = vatomic32_increment(&rcu->reader_count);
+	if (reader >= rcu->max_reader_count)
+	{
+		return -1;
+	}
+
+	vrcu_online(rcu, reader);
+	return reader;
+}
+
+void* vrcu_read(vrcu_t r)
+{
+	vrcu_impl_t* rcu = (vrcu_impl_t*)(r);
+	return (void*)(intptr_t)vatomic64_load(&rcu->data);
+}
+
+void vrcu_quiescent(vrcu_t r, int reader)
+{
+	vrcu_impl_t* rcu = (vrcu_impl_t*)(r);
+
+	/*
+	** The release store orders it after this reader's earlier reads. Later
+	** reads happen after the epoch load, so they see any version published
+	** before that epoch began.
+	*/
+	vatomic64_store(&rcu->readers[reader].epoch, vatomic64_load(&rcu->epoch));
+}
+
+void vrcu_offline(vrcu_t r, int reader)
+{
+	vrcu_impl_t* rcu = (vrcu_impl_t*)(r);
+	vatomic64_store(&rcu->readers[reader].epoch, 0);
+}
+
+void vrcu_online(vrcu_t r, int reader)
+{
+	vrcu_impl_t* rcu = (vrcu_impl_t*)(r);
+
+	/*
+	** A publisher may have seen this reader offline and skipped it. The full
+	** barrier keeps the reader's next vrcu_read from happening before it is
+	** visibly online.
+	*/
+	vatomic64_exchange(&rcu->readers[reader].epoch, vatomic64_load(&rcu->epoch));
+}
+
+void* vrcu_publish(vrcu_t r, void* data, int64_t* grace_period)
+{
+	vrcu_impl_t* rcu = (vrcu_impl_t*)(r);
+
+	/* Swap first, so a reader that sees the new epoch also sees the new pointer. */
+	void* previous = (void*)(intptr_t)vatomic64_exchange(&rcu->data, (int64_t)(intptr_t)data);
+	*grace_period = vatomic64_increment(&rcu->epoch) + 1;
+
+	return previous;
+}
+
+bool vrcu_poll(vrcu_t r, int64_t grace_period)
+{
+	vrcu_impl_t* rcu = (vrcu_impl_t*)(r);
+
+	int reader_count = __min(vatomic32_load(&rcu->reader_count), rcu->max_reader_count);
+	for (int i = 0; i < reader_count; ++i)
+	{
+		int64_t epoch = vatomic64_load(&rcu->readers[i].epoch);
+		if (epoch && epoch < grace_period)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void vrcu_synchronize(vrcu_t r, int64_t grace_period)
+{
+	while (!vrcu_poll(r, grace_period))
+	{
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+/*
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to
+** deal in the Software without restriction, including without limitation the
+** rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+** sell copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+** IN THE SOFTWARE.
+**
+** Sequence lock for small blocks of plain data that are read often and
+** written rarely. Readers copy the block and retry if a write overlapped the
+** copy; they never write shared memory.
+*/
+
+#include "vbase.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Handle to sequence lock. */
+typedef void* vseqlock_t;
+
+/*
+** Gets the amount of memory required by a sequence lock protecting a block of the specified size.
+** @param data_size Size of the protected block, in bytes.
+** @return The amount of memory required.
+** @see vseqlock_create
+*/
+size_t vseqlock_get_bytes_required(size_t data_size);
+
+/*
+** Create a sequence lock.
+** @param buffer A buffer of size vseqlock_get_bytes_required().
+** @param data_size Size of the protected block, in bytes.
+** @param data Initial contents of the block. If NULL, the block is zeroed.
+** @return A new sequence lock.
+** @see vseqlock_get_bytes_required
+*/
+vseqlock_t vseqlock_create(void* buffer, size_t data_size, const void* data);
+
+/*
+** Copy the protected block out. Spins while a write is in progress.
+** @param lock The lock to read.
+** @param data Destination of at least data_size bytes.
+** @see vseqlock_write
+*/
+void vseqlock_read(vseqlock_t lock, void* data);
+
+/*
+** Replace the protected block. Writers are serialized with each other.
+** @param lock The lock to write.
+** @param data Source of data_size bytes.
+** @see vseqlock_read
+*/
+void vseqlock_write(vseqlock_t lock, const void* data);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,113 @@
+/*
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to
+** deal in the Software without restriction, including without limitation the
+** rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+** sell copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+** IN THE SOFTWARE.
+*/
+
+#include "thread/vseqlock.h"
+
+#include "thread/vatomic.h"
+
+#include <string.h>
+
+typedef struct _vseqlock_impl_t
+{
+	/* Odd while a write is in progress. */
+	int32_t sequence;
+
+	size_t data_size;
+} vseqlock_impl_t;
+
+size_t vseqlock_get_bytes_required(size_t data_size)
+{
+	return sizeof(vseqlock_impl_t) + data_size;
+}
+
+vseqlock_t vseqlock_create(void* buffer, size_t data_size, const void* data)
+{
+	vseqlock_impl_t* lock = (vseqlock_impl_t*)buffer;
+
+	lock->sequence = 0;
+	lock->data_size = data_size;
+
+	if (data)
+	{
+		memcpy(lock + 1, data, data_size);
+	}
+	else
+	{
+		memset(lock + 1, 0, data_size);
+	}
+
+	vatomic_barrier();
+
+	return lock;
+}
+
+void vseqlock_read(vseqlock_t l, void* data)
+{
+	vseqlock_impl_t* lock = (vseqlock_impl_t*)(l);
+
+	for (;;)
+	{
+		int32_t sequence = vatomic32_load(&lock->sequence);
+
+		/* Wait out writes in progress rather than copying torn data. */
+		if (sequence & 1)
+		{
+			continue;
+		}
+
+		memcpy(data, lock + 1, lock->data_size);
+
+		/*
+		** If no write started while copying, the copy is consistent. The fence
+		** keeps the copy from moving past the second sequence load.
+		*/
+		vatomic_acquire_fence();
+		if (vatomic32_load(&lock->sequence) == sequence)
+		{
+			break;
+		}
+	}
+}
+
+void vseqlock_write(vseqlock_t l, const void* data)
+{
+	vseqlock_impl_t* lock = (vseqlock_impl_t*)(l);
+	int32_t sequence;
+
+	/* Make the sequence odd to claim the block. This also excludes other writers. */
+	for (;;)
+	{
+		sequence = vatomic32_load(&lock->sequence);
+		if (!(sequence & 1) && vatomic32_compare_exchange(&lock->sequence, sequence, sequence + 1) == sequence)
+		{
+			break;
+		}
+	}
+
+	/* Keep the new data from becoming visible under the old, even sequence. */
+	vatomic_release_fence();
+
+	memcpy(lock + 1, data, lock->data_size);
+
+	/* Publish. The release store keeps the copy from moving past it. */
+	vatomic32_store(&lock->sequence, sequence + 2);
+}
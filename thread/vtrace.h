@@ -0,0 +1,151 @@
+#pragma once
+
+/*
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to
+** deal in the Software without restriction, including without limitation the
+** rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+** sell copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+** IN THE SOFTWARE.
+**
+** Low overhead tracing. Each thread writes begin/end/counter records into its
+** own wrap-around ring with no atomic operations. A drain thread collects the
+** rings and exports them as Chrome trace JSON (chrome://tracing, Perfetto).
+*/
+
+#include "vbase.h"
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Handle to a trace. */
+typedef void* vtrace_t;
+
+/*
+** Gets the amount of memory required by a trace.
+** @param max_thread_count Maximum number of threads recording into the trace at once.
+** @return The amount of memory required.
+** @see vtrace_create
+*/
+size_t vtrace_get_bytes_required(int max_thread_count);
+
+/*
+** Create a trace. Calibrates the timestamp counter, which takes about 10ms.
+** @param buffer A buffer of size vtrace_get_bytes_required().
+** @param max_thread_count Maximum number of threads recording into the trace at once.
+**        A thread's slot is reused once it has called vtrace_thread_end and its ring has been drained.
+** @return A new trace.
+** @see vtrace_get_bytes_required
+*/
+vtrace_t vtrace_create(void* buffer, int max_thread_count);
+
+/*
+** Gets the amount of memory required by a thread's record ring.
+** @param record_count Number of records in the ring. Rounded up to a power of two.
+** @return The amount of memory required.
+** @see vtrace_thread_begin
+*/
+size_t vtrace_thread_get_bytes_required(int record_count);
+
+/*
+** Start recording events from the calling thread. When the ring is full the
+** oldest records are overwritten. If max_thread_count threads are already
+** recording, the thread is not recorded. Calling this again on a recording
+** thread ends its previous ring first.
+** @param trace The trace to record into.
+** @param buffer A buffer of size vtrace_thread_get_bytes_required(). Must stay valid until
+**        vtrace_thread_end, and a vtrace_json_drain that starts after it, have returned.
+** @param record_count Number of records in the ring. Rounded up to a power of two.
+** @param thread_name Name shown for the thread. Must outlive the trace.
+** @see vtrace_thread_end
+*/
+void vtrace_thread_begin(vtrace_t trace, void* buffer, int record_count, const char* thread_name);
+
+/*
+** Stop recording events from the calling thread. Records already written are
+** still drained, after which the ring is retired and its slot is free for
+** another thread.
+** @see vtrace_thread_begin
+*/
+void vtrace_thread_end();
+
+/*
+** Record the start of a duration event on the calling thread.
+** Does nothing if the thread is not recording.
+** @param name Name of the event. Must outlive the trace, normally a string literal.
+** @see vtrace_end
+*/
+void vtrace_begin(const char* name);
+
+/*
+** Record the end of a duration event on the calling thread.
+** @param name Name of the event, matching the call to vtrace_begin.
+** @see vtrace_begin
+*/
+void vtrace_end(const char* name);
+
+/*
+** Record the value of a counter on the calling thread.
+** @param name Name of the counter. Must outlive the trace, normally a string literal.
+** @param value Value of the counter.
+*/
+void vtrace_counter(const char* name, int64_t value);
+
+/*
+** Start a Chrome trace JSON document.
+** @param trace The trace to export.
+** @param file Destination file.
+** @see vtrace_json_drain
+*/
+void vtrace_json_open(vtrace_t trace, FILE* file);
+
+/*
+** Write all records recorded since the last drain. Call periodically from a
+** single drain thread, often enough that the rings do not wrap. Records
+** overwritten before they could be drained are dropped.
+** @param trace The trace to export.
+** @param file Destination file, previously passed to vtrace_json_open.
+** @return The number of events written.
+*/
+int vtrace_json_drain(vtrace_t trace, FILE* file);
+
+/*
+** Drain remaining records and finish the Chrome trace JSON document.
+** @param trace The trace to export.
+** @param file Destination file, previously passed to vtrace_json_open.
+*/
+void vtrace_json_close(vtrace_t trace, FILE* file);
+
+/*
+** Hooks used by other modules to report contention. Compiled out unless
+** VTRACE_HOOKS is defined.
+*/
+#if defined(VTRACE_HOOKS)
+#define VTRACE_HOOK_BEGIN(NAME) vtrace_begin(NAME)
+#define VTRACE_HOOK_END(NAME) vtrace_end(NAME)
+#define VTRACE_HOOK_COUNTER(NAME, VALUE) vtrace_counter(NAME, VALUE)
+#else
+#define VTRACE_HOOK_BEGIN(NAME) ((void)0)
+#define VTRACE_HOOK_END(NAME) ((void)0)
+#define VTRACE_HOOK_COUNTER(NAME, VALUE) ((void)(VALUE))
+#endif
+
+#ifdef __cplusplus
+}
+#endif
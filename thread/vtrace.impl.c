@@ -0,0 +1,377 @@
+/*
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to
+** deal in the Software without restriction, including without limitation the
+** rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+** sell copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+** IN THE SOFTWARE.
+*/
+
+#include "thread/vtrace.h"
+
+#include "containers/vqueue.h"
+#include "thread/vatomic.h"
+
+#include <time.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#if !defined(_MSC_VER)
+#include <x86intrin.h>
+#endif
+#define VTRACE_RDTSC 1
+#endif
+
+enum
+{
+	k_vtrace_type_begin,
+	k_vtrace_type_end,
+	k_vtrace_type_counter,
+};
+
+typedef struct _vtrace_record_t
+{
+	uint64_t timestamp;
+	const char* name;
+	int64_t value;
+	uint32_t type;
+} vtrace_record_t;
+
+typedef struct _vtrace_ring_t
+{
+	/* Written only by the owning thread. */
+	int64_t write_index;
+	int32_t is_ended;
+	uint32_t record_mask;
+	uint32_t thread_id;
+	const char* thread_name;
+	vtrace_record_t* records;
+
+	/* Used only by the drain thread. */
+	char padding[VCACHE_LINE_SIZE];
+	int64_t read_index;
+} vtrace_ring_t;
+
+typedef struct _vtrace_impl_t
+{
+	int max_thread_count;
+	int32_t next_thread_id;
+
+	/* Rings registered and not yet retired by the drain thread. At most max_thread_count. */
+	int32_t thread_count;
+
+	uint64_t base_timestamp;
+	double timestamps_per_us;
+
+	/* Rings registered by threads, not yet picked up by the drain thread. */
+	vqueue_t new_rings;
+
+	/* Drain thread state. */
+	int ring_count;
+	vtrace_ring_t** rings;
+	int64_t event_count;
+} vtrace_impl_t;
+
+static __thread vtrace_ring_t* t_vtrace_ring = NULL;
+
+static uint64_t _get_time_ns();
+static force_inline uint64_t _read_timestamp();
+static force_inline void _write_record(uint32_t type, const char* name, int64_t value);
+static int _drain_ring(vtrace_impl_t* trace, vtrace_ring_t* ring, FILE* file);
+static void _write_event_prefix(vtrace_impl_t* trace, FILE* file);
+static void _write_string(FILE* file, const char* string);
+
+size_t vtrace_get_bytes_required(int max_thread_count)
+{
+	return sizeof(vtrace_impl_t) + (sizeof(vtrace_ring_t*) * max_thread_count) + vqueue_get_bytes_required_ex(max_thread_count + 1, k_vqueue_flag_no_count);
+}
+
+vtrace_t vtrace_create(void* buffer, int max_thread_count)
+{
+	vtrace_impl_t* trace = (vtrace_impl_t*)buffer;
+
+	trace->max_thread_count = max_thread_count;
+	trace->next_thread_id = 0;
+	trace->thread_count = 0;
+	trace->ring_count = 0;
+	trace->rings = (vtrace_ring_t**)(trace + 1);
+	trace->event_count = 0;
+
+	/* The queue needs a spare node for its dummy. */
+	trace->new_rings = vqueue_create_ex(trace->rings + max_thread_count, max_thread_count + 1, k_vqueue_flag_no_count);
+
+	/* Measure timestamp frequency against the wall clock. */
+#if defined(VTRACE_RDTSC)
+	uint64_t start_ns = _get_time_ns();
+	uint64_t start = _read_timestamp();
+	uint64_t end_ns;
+	do
+	{
+		end_ns = _get_time_ns();
+	} while (end_ns - start_ns < 10000000);
+	uint64_t end = _read_timestamp();
+	trace->timestamps_per_us = (double)(end - start) * 1000.0 / (double)(end_ns - start_ns);
+#else
+	trace->timestamps_per_us = 1000.0;
+#endif
+	trace->base_timestamp = _read_timestamp();
+
+	vatomic_barrier();
+
+	return trace;
+}
+
+size_t vtrace_thread_get_bytes_required(int record_count)
+{
+	size_t rounded_count = 1;
+	while (rounded_count < (size_t)record_count)
+	{
+		rounded_count <<= 1;
+	}
+	return sizeof(vtrace_ring_t) + (sizeof(vtrace_record_t) * rounded_count);
+}
+
+void vtrace_thread_begin(vtrace_t t, void* buffer, int record_count, const char* thread_name)
+{
+	vtrace_impl_t* trace = (vtrace_impl_t*)(t);
+
+	/* A thread that begins again gets a new ring; retire the old one. */
+	vtrace_thread_end();
+
+	/* Threads beyond the maximum recording at once are not recorded. The slot is returned when the ring is retired. */
+	for (;;)
+	{
+		int32_t thread_count = vatomic32_load(&trace->thread_count);
+		if (thread_count >= trace->max_thread_count)
+		{
+			return;
+		}
+		if (vatomic32_compare_exchange(&trace->thread_count, thread_count, thread_count + 1) == thread_count)
+		{
+			break;
+		}
+	}
+
+	/* Every registration gets a new ID, so the exported trace doesn't merge threads. */
+	int32_t thread_id = vatomic32_increment(&trace->next_thread_id);
+
+	uint32_t rounded_count = 1;
+	while (rounded_count < (uint32_t)record_count)
+	{
+		rounded_count <<= 1;
+	}
+
+	vtrace_ring_t* ring = (vtrace_ring_t*)buffer;
+	ring->write_index = 0;
+	ring->is_ended = 0;
+	ring->record_mask = rounded_count - 1;
+	ring->thread_id = (uint32_t)thread_id;
+	ring->thread_name = thread_name;
+	ring->records = (vtrace_record_t*)(ring + 1);
+	ring->read_index = 0;
+
+	vatomic_barrier();
+
+	vqueue_push(trace->new_rings, ring);
+	t_vtrace_ring = ring;
+}
+
+void vtrace_thread_end()
+{
+	vtrace_ring_t* ring = t_vtrace_ring;
+	if (!ring)
+	{
+		return;
+	}
+
+	/* Released after the last record, so the drain sees every record before retiring the ring. */
+	t_vtrace_ring = NULL;
+	vatomic32_store(&ring->is_ended, 1);
+}
+
+void vtrace_begin(const char* name)
+{
+	_write_record(k_vtrace_type_begin, name, 0);
+}
+
+void vtrace_end(const char* name)
+{
+	_write_record(k_vtrace_type_end, name, 0);
+}
+
+void vtrace_counter(const char* name, int64_t value)
+{
+	_write_record(k_vtrace_type_counter, name, value);
+}
+
+void vtrace_json_open(vtrace_t t, FILE* file)
+{
+	vtrace_impl_t* trace = (vtrace_impl_t*)(t);
+	trace->event_count = 0;
+	fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", file);
+}
+
+int vtrace_json_drain(vtrace_t t, FILE* file)
+{
+	vtrace_impl_t* trace = (vtrace_impl_t*)(t);
+	int event_count = 0;
+
+	/* Pick up newly registered threads, and name them. */
+	void* data;
+	while (vqueue_pop(trace->new_rings, &data))
+	{
+		vtrace_ring_t* ring = (vtrace_ring_t*)data;
+		trace->rings[trace->ring_count++] = ring;
+
+		_write_event_prefix(trace, file);
+		fputs("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,", file);
+		fprintf(file, "\"tid\":%u,\"args\":{\"name\":", ring->thread_id);
+		_write_string(file, ring->thread_name);
+		fputs("}}", file);
+		++event_count;
+	}
+
+	for (int i = 0; i < trace->ring_count; ++i)
+	{
+		vtrace_ring_t* ring = trace->rings[i];
+
+		/* Check before draining, so an ended ring is drained to its final record. */
+		bool is_ended = vatomic32_load(&ring->is_ended) != 0;
+		event_count += _drain_ring(trace, ring, file);
+
+		/* Retire ended rings, handing the slot back for another thread. */
+		if (is_ended)
+		{
+			trace->rings[i--] = trace->rings[--trace->ring_count];
+			vatomic32_decrement(&trace->thread_count);
+		}
+	}
+
+	return event_count;
+}
+
+void vtrace_json_close(vtrace_t t, FILE* file)
+{
+	vtrace_json_drain(t, file);
+	fputs("\n]}\n", file);
+}
+
+static uint64_t _get_time_ns()
+{
+	struct timespec now;
+	timespec_get(&now, TIME_UTC);
+	return ((uint64_t)now.tv_sec * 1000000000) + (uint64_t)now.tv_nsec;
+}
+
+static force_inline uint64_t _read_timestamp()
+{
+#if defined(VTRACE_RDTSC)
+	return __rdtsc();
+#else
+	return _get_time_ns();
+#endif
+}
+
+static force_inline void _write_record(uint32_t type, const char* name, int64_t value)
+{
+	vtrace_ring_t* ring = t_vtrace_ring;
+	if (!ring)
+	{
+		return;
+	}
+
+	int64_t index = ring->write_index;
+	vtrace_record_t* record = ring->records + (index & ring->record_mask);
+	record->timestamp = _read_timestamp();
+	record->name = name;
+	record->value = value;
+	record->type = type;
+
+	/* Publish the record. The release store is a plain store on x86/x64. */
+	vatomic64_store(&ring->write_index, index + 1);
+}
+
+static int _drain_ring(vtrace_impl_t* trace, vtrace_ring_t* ring, FILE* file)
+{
+	int64_t capacity = (int64_t)ring->record_mask + 1;
+	int64_t write_index = vatomic64_load(&ring->write_index);
+	int64_t index = __max(ring->read_index, write_index - capacity);
+	int event_count = 0;
+
+	for (; index < write_index; ++index)
+	{
+		vtrace_record_t record = ring->records[index & ring->record_mask];
+
+		/*
+		** The owner may have lapped us while copying. The slot of the record
+		** it is writing is one ring behind its write index. The fence keeps the
+		** copy from moving past the index load.
+		*/
+		vatomic_acquire_fence();
+		int64_t current_index = vatomic64_load(&ring->write_index);
+		if (index + capacity <= current_index)
+		{
+			continue;
+		}
+
+		double timestamp_us = (double)(int64_t)(record.timestamp - trace->base_timestamp) / trace->timestamps_per_us;
+
+		_write_event_prefix(trace, file);
+		fputs("{\"name\":", file);
+		_write_string(file, record.name);
+		switch (record.type)
+		{
+		case k_vtrace_type_begin:
+			fprintf(file, ",\"ph\":\"B\",\"ts\":%.3f,\"pid\":0,\"tid\":%u}", timestamp_us, ring->thread_id);
+			break;
+		case k_vtrace_type_end:
+			fprintf(file, ",\"ph\":\"E\",\"ts\":%.3f,\"pid\":0,\"tid\":%u}", timestamp_us, ring->thread_id);
+			break;
+		default:
+			fprintf(file, ",\"ph\":\"C\",\"ts\":%.3f,\"pid\":0,\"tid\":%u,\"args\":{\"value\":%lld}}", timestamp_us, ring->thread_id, (long long)record.value);
+			break;
+		}
+		++event_count;
+	}
+
+	ring->read_index = write_index;
+	return event_count;
+}
+
+static void _write_event_prefix(vtrace_impl_t* trace, FILE* file)
+{
+	fputs(trace->event_count++ ? ",\n" : "\n", file);
+}
+
+static void _write_string(FILE* file, const char* string)
+{
+	fputc('"', file);
+	for (; *string; ++string)
+	{
+		if (*string == '"' || *string == '\\')
+		{
+			fputc('\\', file);
+		}
+		if ((unsigned char)*string >= ' ')
+		{
+			fputc(*string, file);
+		}
+	}
+	fputc('"', file);
+}
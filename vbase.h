@@ -74,6 +74,16 @@
 #error Cannot define __thread
 #endif
 
+/* Size of a cache line, in bytes. Used to keep contended data from false sharing. */
+#define VCACHE_LINE_SIZE 64
+
+/* Aligns a struct to a cache line, e.g. typedef struct VCACHE_ALIGNED _foo_t { ... } foo_t; */
+#if defined(__clang__) || defined(__GNUC__)
+#define VCACHE_ALIGNED __attribute__((aligned(VCACHE_LINE_SIZE)))
+#elif defined(_MSC_VER)
+#define VCACHE_ALIGNED __declspec(align(VCACHE_LINE_SIZE))
+#endif
+
 #define CAT2(a,b) a##b
 #define CAT(a,b) CAT2(a,b)
 #define UNIQUE_ID(PREFIX) CAT(PREFIX,CAT(__LINE__,__COUNTER__))